@@ -0,0 +1,315 @@
+#pragma once
+#ifndef AGENT_SYSTEM_CLASS_H
+#define AGENT_SYSTEM_CLASS_H
+
+#include "math/v3d.h"
+#include "NavGraph.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AGENT_SYSTEM_SSE2
+#endif
+
+//-1 is no path
+typedef int PathHandle;
+
+//path followers, stored as structure of arrays: one array per field,
+//indexed by agent, so the update streams through each of them in order.
+//
+//paths live in one shared store, as flat waypoint arrays, and agents
+//hold a handle plus how far along they are. many agents can share a
+//path. a path is freed when its last agent leaves it, and the waypoint
+//arrays are compacted once more of them is garbage than not.
+//
+//update() runs in chunks of agents over the pool. each chunk gathers
+//its next waypoints into scratch arrays first, so the stepping loop in
+//between is straight float math over contiguous arrays with no branches,
+//four agents at a time, see move().
+//
+//agent indexes are dense, removeAgent moves the last agent into the gap.
+class AgentSystem
+{
+public:
+	//read freely, change through the methods below
+	std::vector<float> pos_x, pos_y, pos_z;
+	std::vector<float> vel_x, vel_y, vel_z;
+	std::vector<float> speed;
+	std::vector<PathHandle> path;
+	//next waypoint to head for, the path length once arrived
+	std::vector<int> waypoint;
+
+	//agents per parallelFor task
+	int chunk_size = 1024;
+
+private:
+	//waypoint store, path h is [path_begin[h], path_end[h])
+	std::vector<float> way_x, way_y, way_z;
+	std::vector<int> path_begin, path_end, path_users;
+	std::vector<PathHandle> free_paths;
+	int garbage = 0;
+
+	//per agent scratch for update()
+	std::vector<float> target_x, target_y, target_z;
+	std::vector<uint8_t> reached;
+
+	std::vector<std::vector<int>> arrivals;
+	std::vector<int> just_arrived;
+
+	int pathLength(PathHandle h) const { return path_end[h] - path_begin[h]; }
+
+	void release(PathHandle h)
+	{
+		if (h < 0 || --path_users[h] > 0) return;
+		garbage += pathLength(h);
+		path_begin[h] = path_end[h] = 0;
+		free_paths.push_back(h);
+	}
+
+	//moves live paths to the front of the store, handles stay the same
+	void compact()
+	{
+		std::vector<int> order;
+		for (int h = 0; h < (int)path_begin.size(); h++)
+		{
+			if (path_users[h] > 0 || pathLength(h) > 0) order.push_back(h);
+		}
+		//in store order, so everything only ever moves down
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return path_begin[a] < path_begin[b]; });
+
+		int end = 0;
+		for (const auto& h : order)
+		{
+			const int len = pathLength(h);
+			std::copy(way_x.begin() + path_begin[h], way_x.begin() + path_end[h], way_x.begin() + end);
+			std::copy(way_y.begin() + path_begin[h], way_y.begin() + path_end[h], way_y.begin() + end);
+			std::copy(way_z.begin() + path_begin[h], way_z.begin() + path_end[h], way_z.begin() + end);
+			path_begin[h] = end;
+			path_end[h] = end += len;
+		}
+		way_x.resize(end), way_y.resize(end), way_z.resize(end);
+		garbage = 0;
+	}
+
+	//moves count agents toward their targets, reached[i] if one got there.
+	//sse2 by hand: with the default flags gcc and clang wont vectorize the
+	//sqrt (it may set errno) and msvc wont vectorize the selects, and left
+	//to the compiler this ran slower than plain structs. same operations
+	//in the same order as the scalar loop, which does the tail and any
+	//target without sse2, so the results dont depend on which one ran.
+	static void move(int count, float dt, const float* __restrict sp,
+		const float* __restrict tx, const float* __restrict ty, const float* __restrict tz,
+		float* __restrict px, float* __restrict py, float* __restrict pz,
+		float* __restrict vx, float* __restrict vy, float* __restrict vz, uint8_t* __restrict reached)
+	{
+		int i = 0;
+#ifdef AGENT_SYSTEM_SSE2
+		const __m128 step = _mm_set1_ps(dt), tiny = _mm_set1_ps(1e-6f), one = _mm_set1_ps(1);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(px + i), y = _mm_loadu_ps(py + i), z = _mm_loadu_ps(pz + i);
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(tx + i), x);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(ty + i), y);
+			__m128 dz = _mm_sub_ps(_mm_loadu_ps(tz + i), z);
+			__m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			__m128 s = _mm_loadu_ps(sp + i);
+			__m128 reach = _mm_mul_ps(s, step);
+			__m128 inv_dist = _mm_div_ps(one, _mm_max_ps(dist, tiny));
+			__m128 t = _mm_min_ps(_mm_mul_ps(reach, inv_dist), one);
+			__m128 inv = _mm_and_ps(_mm_cmpgt_ps(dist, tiny), _mm_mul_ps(s, inv_dist));
+			_mm_storeu_ps(px + i, _mm_add_ps(x, _mm_mul_ps(t, dx)));
+			_mm_storeu_ps(py + i, _mm_add_ps(y, _mm_mul_ps(t, dy)));
+			_mm_storeu_ps(pz + i, _mm_add_ps(z, _mm_mul_ps(t, dz)));
+			_mm_storeu_ps(vx + i, _mm_mul_ps(inv, dx));
+			_mm_storeu_ps(vy + i, _mm_mul_ps(inv, dy));
+			_mm_storeu_ps(vz + i, _mm_mul_ps(inv, dz));
+			int mask = _mm_movemask_ps(_mm_cmple_ps(dist, reach));
+			for (int k = 0; k < 4; k++) reached[i + k] = (mask >> k) & 1;
+		}
+#endif
+		for (; i < count; i++)
+		{
+			float dx = tx[i] - px[i], dy = ty[i] - py[i], dz = tz[i] - pz[i];
+			float dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+			float reach = sp[i] * dt;
+			//no division under a condition, that would be a branch
+			float inv_dist = 1 / std::max(dist, 1e-6f);
+			//snap onto the target when it is within this step
+			float t = std::min(reach * inv_dist, 1.f);
+			float inv = dist > 1e-6f ? sp[i] * inv_dist : 0.f;
+			px[i] += t * dx, py[i] += t * dy, pz[i] += t * dz;
+			vx[i] = inv * dx, vy[i] = inv * dy, vz[i] = inv * dz;
+			reached[i] = dist <= reach;
+		}
+	}
+
+	//gather, move, then advance waypoints for agents [b, e)
+	void step(int b, int e, float dt, std::vector<int>& arrived)
+	{
+		for (int i = b; i < e; i++)
+		{
+			const PathHandle h = path[i];
+			const bool moving = h >= 0 && waypoint[i] < pathLength(h);
+			const int k = moving ? path_begin[h] + waypoint[i] : 0;
+			//standing agents target themselves, so they stay put
+			target_x[i] = moving ? way_x[k] : pos_x[i];
+			target_y[i] = moving ? way_y[k] : pos_y[i];
+			target_z[i] = moving ? way_z[k] : pos_z[i];
+		}
+
+		move(e - b, dt, speed.data() + b, target_x.data() + b, target_y.data() + b, target_z.data() + b,
+			pos_x.data() + b, pos_y.data() + b, pos_z.data() + b, vel_x.data() + b, vel_y.data() + b, vel_z.data() + b, reached.data() + b);
+
+		for (int i = b; i < e; i++)
+		{
+			const PathHandle h = path[i];
+			if (!reached[i] || h < 0 || waypoint[i] >= pathLength(h)) continue;
+			if (++waypoint[i] < pathLength(h)) continue;
+			vel_x[i] = vel_y[i] = vel_z[i] = 0;
+			arrived.push_back(i);
+		}
+	}
+
+public:
+	AgentSystem() {}
+
+	int size() const { return pos_x.size(); }
+
+	void clear()
+	{
+		pos_x.clear(), pos_y.clear(), pos_z.clear();
+		vel_x.clear(), vel_y.clear(), vel_z.clear();
+		speed.clear(), path.clear(), waypoint.clear();
+		way_x.clear(), way_y.clear(), way_z.clear();
+		path_begin.clear(), path_end.clear(), path_users.clear();
+		free_paths.clear();
+		garbage = 0;
+		just_arrived.clear();
+	}
+
+	//standing still with no path. returns its index.
+	int addAgent(const cmn::vf3d& p, float agent_speed)
+	{
+		pos_x.push_back(p.x), pos_y.push_back(p.y), pos_z.push_back(p.z);
+		vel_x.push_back(0), vel_y.push_back(0), vel_z.push_back(0);
+		speed.push_back(agent_speed);
+		path.push_back(-1);
+		waypoint.push_back(0);
+		return size() - 1;
+	}
+
+	//the last agent takes index i
+	void removeAgent(int i)
+	{
+		release(path[i]);
+		const int last = size() - 1;
+		for (auto* field : { &pos_x, &pos_y, &pos_z, &vel_x, &vel_y, &vel_z, &speed })
+		{
+			(*field)[i] = (*field)[last];
+			field->pop_back();
+		}
+		path[i] = path[last], path.pop_back();
+		waypoint[i] = waypoint[last], waypoint.pop_back();
+	}
+
+	//stored once, hand the handle to as many agents as like.
+	//a path no agent ever takes stays until clear().
+	PathHandle addPath(const std::vector<cmn::vf3d>& waypoints)
+	{
+		PathHandle h;
+		if (free_paths.size())
+		{
+			h = free_paths.back();
+			free_paths.pop_back();
+		}
+		else
+		{
+			h = path_begin.size();
+			path_begin.push_back(0), path_end.push_back(0), path_users.push_back(0);
+		}
+		path_begin[h] = way_x.size();
+		for (const auto& w : waypoints)
+		{
+			way_x.push_back(w.x), way_y.push_back(w.y), way_z.push_back(w.z);
+		}
+		path_end[h] = way_x.size();
+		path_users[h] = 0;
+		return h;
+	}
+
+	//node indexes from a route on nav
+	PathHandle addPath(const NavGraph& nav, const std::vector<int>& nodes)
+	{
+		std::vector<cmn::vf3d> waypoints;
+		waypoints.reserve(nodes.size());
+		for (const auto& n : nodes) waypoints.push_back(nav.pos[n]);
+		return addPath(waypoints);
+	}
+
+	//heads for the path's first waypoint, then along it. -1 stops the agent.
+	void setPath(int i, PathHandle h)
+	{
+		if (h >= (int)path_begin.size()) h = -1;
+		if (h >= 0) path_users[h]++;
+		release(path[i]);
+		path[i] = h;
+		waypoint[i] = 0;
+		vel_x[i] = vel_y[i] = vel_z[i] = 0;
+	}
+
+	void teleport(int i, const cmn::vf3d& p)
+	{
+		pos_x[i] = p.x, pos_y[i] = p.y, pos_z[i] = p.z;
+	}
+
+	cmn::vf3d position(int i) const { return { pos_x[i], pos_y[i], pos_z[i] }; }
+	cmn::vf3d velocity(int i) const { return { vel_x[i], vel_y[i], vel_z[i] }; }
+
+	//at the end of its path, or without one
+	bool arrived(int i) const { return path[i] < 0 || waypoint[i] >= pathLength(path[i]); }
+
+	//paths stored and not freed yet
+	int numPaths() const { return path_begin.size() - free_paths.size(); }
+
+	//agents that reached the end of their path in the last update(), ascending
+	const std::vector<int>& justArrived() const { return just_arrived; }
+
+	size_t memoryUsage() const
+	{
+		size_t floats = pos_x.capacity() + pos_y.capacity() + pos_z.capacity()
+			+ vel_x.capacity() + vel_y.capacity() + vel_z.capacity() + speed.capacity()
+			+ target_x.capacity() + target_y.capacity() + target_z.capacity()
+			+ way_x.capacity() + way_y.capacity() + way_z.capacity();
+		size_t ints = path.capacity() + waypoint.capacity()
+			+ path_begin.capacity() + path_end.capacity() + path_users.capacity() + free_paths.capacity();
+		return floats * sizeof(float) + ints * sizeof(int) + reached.capacity();
+	}
+
+	//moves everyone dt seconds along their paths. returns how many arrived.
+	int update(float dt, ThreadPool& pool = ThreadPool::shared())
+	{
+		if (garbage > 4096 && 2 * garbage > (int)way_x.size()) compact();
+
+		const int n = size();
+		target_x.resize(n), target_y.resize(n), target_z.resize(n);
+		reached.resize(n);
+		arrivals.resize(pool.size());
+		for (auto& a : arrivals) a.clear();
+
+		const int chunk = std::max(1, chunk_size);
+		pool.parallelFor((n + chunk - 1) / chunk, [&](int c, int worker) {
+			step(c * chunk, std::min(n, (c + 1) * chunk), dt, arrivals[worker]);
+		}, 1);
+
+		just_arrived.clear();
+		for (const auto& a : arrivals) just_arrived.insert(just_arrived.end(), a.begin(), a.end());
+		std::sort(just_arrived.begin(), just_arrived.end());
+		return just_arrived.size();
+	}
+};
+#endif//AGENT_SYSTEM_CLASS_H
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef COMPONENTS_CLASS_H
+#define COMPONENTS_CLASS_H
+
+#include <utility>
+#include <vector>
+
+//union-find over dense ids [0, size), union by size with path halving,
+//so unite/find are as good as O(1). it can only ever merge, so whoever
+//owns one throws it away and starts over when an edge goes missing.
+//links are treated as two way: ids in different sets have no path
+//between them either way, ids in the same set usually do, but with one
+//way links that is not a promise.
+class DisjointSets
+{
+	std::vector<int> parent;
+	std::vector<int> count;
+	int sets = 0;
+
+public:
+	//n singletons
+	void reset(int n)
+	{
+		parent.resize(n);
+		count.assign(n, 1);
+		for (int i = 0; i < n; i++) parent[i] = i;
+		sets = n;
+	}
+
+	int size() const { return parent.size(); }
+	int numSets() const { return sets; }
+
+	int find(int i)
+	{
+		while (parent[i] != i)
+		{
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+
+	//false if they were together already
+	bool unite(int a, int b)
+	{
+		a = find(a), b = find(b);
+		if (a == b) return false;
+		if (count[a] < count[b]) std::swap(a, b);
+		parent[b] = a;
+		count[a] += count[b];
+		sets--;
+		return true;
+	}
+
+	bool same(int a, int b) { return find(a) == find(b); }
+
+	//dense labels [0, numSets()), numbered in order of first appearance
+	std::vector<int> labels()
+	{
+		std::vector<int> out(size(), -1);
+		int next = 0;
+		for (int i = 0; i < size(); i++)
+		{
+			int r = find(i);
+			if (out[r] < 0) out[r] = next++;
+			out[i] = out[r];
+		}
+		return out;
+	}
+
+	size_t memoryUsage() const
+	{
+		return (parent.capacity() + count.capacity()) * sizeof(int);
+	}
+};
+#endif//COMPONENTS_CLASS_H
@@ -0,0 +1,537 @@
+#pragma once
+#ifndef CONTRACTION_HIERARCHY_CLASS_H
+#define CONTRACTION_HIERARCHY_CLASS_H
+
+#include "NavGraph.h"
+#include "SearchContext.h"
+#include "IndexedHeap.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+//contraction hierarchy over a frozen NavGraph.
+//preprocessing contracts nodes least "important" first, in rounds of
+//nodes that arent adjacent, adding shortcut edges wherever a shortest
+//path ran through the node.
+//queries then only ever walk up the ranking from both ends,
+//which touches a few hundred nodes instead of most of the map.
+//the graph must not change after building, rebuild if it does.
+class ContractionHierarchy
+{
+public:
+	struct Edge
+	{
+		int to;
+		float cost;
+		//node this shortcut skips over, -1 for an original link
+		int mid;
+	};
+
+	struct BuildStats
+	{
+		int shortcuts = 0;
+		double ms = 0;
+	};
+
+private:
+	//up[v]: edges v->w with rank[w] > rank[v], searched forward from the start.
+	//down[v]: edges w->v with rank[w] > rank[v] stored as {w}, searched backward from the goal.
+	std::vector<int> up_offsets{ 0 }, down_offsets{ 0 };
+	std::vector<Edge> up_edges, down_edges;
+	std::vector<int> rank;
+	//for the a* bound on queries, see route
+	std::vector<cmn::vf3d> pos;
+	int num_shortcuts = 0;
+
+	//search state reused across witness searches, one per thread
+	struct Scratch
+	{
+		SearchContext ctx;
+		std::vector<int> hops;
+		//target[w] == round while w is one of v's out neighbors still
+		//waiting for a witness, -round once one turned up
+		std::vector<int> target;
+		std::vector<float> via;
+		//unresolved targets, dearest first
+		std::vector<std::pair<float, int>> goals;
+		const std::vector<cmn::vf3d>* pos = nullptr;
+		int round = 0;
+	};
+
+	//witness search: for each out neighbor w of v, is there a path u -> w
+	//that avoids v and costs no more than u -> v -> w.
+	//a* toward v, whose neighbors are all within radius of it, and the
+	//limit drops to the dearest pair still open as witnesses turn up.
+	//any path that cheap will do, it doesnt have to be the shortest,
+	//so a target counts as soon as it is reached for that much.
+	//bounded by settled count and by hops so contraction stays cheap,
+	//which may add a few unneeded shortcuts but never drops a needed one.
+	//with sym only w > u are looked for, w -> u would find the same.
+	static void witness(const std::vector<std::vector<Edge>>& out,
+		int u, int v, float u_cost, Scratch& s, int max_settled, int max_hops, bool sym)
+	{
+		const std::vector<cmn::vf3d>& pos = *s.pos;
+		s.round++;
+		s.goals.clear();
+		float radius = 0;
+		for (const auto& oe : out[v])
+		{
+			if (oe.to == u || (sym && oe.to < u)) continue;
+			s.target[oe.to] = s.round;
+			s.via[oe.to] = u_cost + oe.cost;
+			s.goals.push_back({ u_cost + oe.cost, oe.to });
+			radius = std::max(radius, (pos[oe.to] - pos[v]).mag());
+		}
+		std::sort(s.goals.begin(), s.goals.end(), std::greater<>());
+		auto h = [&](int i) { return std::max(0.f, (pos[i] - pos[v]).mag() - radius); };
+
+		SearchContext& ctx = s.ctx;
+		ctx.begin(out.size());
+		ctx.visit(u, 0, -1);
+		ctx.open.push(u, h(u));
+		s.hops[u] = 0;
+
+		int settled = 0, next = 0;
+		while (!ctx.open.empty())
+		{
+			while (next < (int)s.goals.size() && s.target[s.goals[next].second] != s.round) next++;
+			if (next == (int)s.goals.size()) break;
+			const float limit = s.goals[next].first;
+
+			if (ctx.open.topKey() > limit) break;
+			int curr = ctx.open.pop();
+			ctx.close(curr);
+			if (++settled > max_settled) break;
+			if (s.hops[curr] >= max_hops) continue;
+
+			for (const auto& e : out[curr])
+			{
+				if (e.to == v || ctx.isClosed(e.to)) continue;
+				float g = ctx.g_cost[curr] + e.cost;
+				if (ctx.isSeen(e.to) && g >= ctx.g_cost[e.to]) continue;
+				if (s.target[e.to] == s.round && g <= s.via[e.to]) s.target[e.to] = -s.round;
+
+				float f = g + h(e.to);
+				if (f > limit) continue;
+				ctx.visit(e.to, g, curr);
+				s.hops[e.to] = s.hops[curr] + 1;
+				//nodes on the last hop are never expanded, their cost is all that counts
+				if (ctx.open.contains(e.to)) ctx.open.decrease(e.to, f);
+				else if (s.hops[e.to] < max_hops) ctx.open.push(e.to, f);
+			}
+		}
+	}
+
+	//keep the cheaper of parallel edges
+	static void addOrLower(std::vector<Edge>& edges, int to, float cost, int mid)
+	{
+		for (auto& e : edges)
+		{
+			if (e.to != to) continue;
+			if (cost < e.cost) e.cost = cost, e.mid = mid;
+			return;
+		}
+		edges.push_back({ to, cost, mid });
+	}
+
+	//shortcuts needed to contract v right now, optionally applied.
+	//out/in only ever hold edges between uncontracted nodes.
+	//sym: every edge has a twin back at the same cost, shortcuts are
+	//added in pairs and so that stays true.
+	static int contract(std::vector<std::vector<Edge>>& out, std::vector<std::vector<Edge>>& in,
+		int v, bool apply, Scratch& s, int max_settled, int max_hops, bool sym)
+	{
+		int num = 0;
+		for (const auto& ie : in[v])
+		{
+			int u = ie.to;
+
+			//one search from u covers every w
+			witness(out, u, v, ie.cost, s, max_settled, max_hops, sym);
+
+			for (const auto& oe : out[v])
+			{
+				int w = oe.to;
+				if (w == u || (sym && w < u) || s.target[w] == -s.round) continue;
+
+				num += sym ? 2 : 1;
+				if (!apply) continue;
+
+				float via = ie.cost + oe.cost;
+				addOrLower(out[u], w, via, v);
+				addOrLower(in[w], u, via, v);
+				if (sym) addOrLower(out[w], u, via, v), addOrLower(in[u], w, via, v);
+			}
+		}
+		return num;
+	}
+
+	static void removeEdgesTo(std::vector<Edge>& edges, int to)
+	{
+		edges.erase(std::remove_if(edges.begin(), edges.end(), [to](const Edge& e) { return e.to == to; }), edges.end());
+	}
+
+	//cheapest stored edge a->b, either original or shortcut
+	const Edge* findEdge(int a, int b) const
+	{
+		const Edge* best = nullptr;
+		if (rank[a] < rank[b])
+		{
+			for (int i = up_offsets[a]; i < up_offsets[a + 1]; i++)
+			{
+				const Edge& e = up_edges[i];
+				if (e.to == b && (!best || e.cost < best->cost)) best = &e;
+			}
+		}
+		else
+		{
+			for (int i = down_offsets[b]; i < down_offsets[b + 1]; i++)
+			{
+				const Edge& e = down_edges[i];
+				if (e.to == a && (!best || e.cost < best->cost)) best = &e;
+			}
+		}
+		return best;
+	}
+
+	//expand a->b back into original links, appends everything after a.
+	void unpack(int a, int b, std::vector<int>& path) const
+	{
+		std::vector<std::pair<int, int>> stack{ { a, b } };
+		while (stack.size())
+		{
+			auto ab = stack.back();
+			stack.pop_back();
+
+			const Edge* e = findEdge(ab.first, ab.second);
+			if (!e || e->mid < 0)
+			{
+				path.push_back(ab.second);
+				continue;
+			}
+
+			//second half goes on first so the first half pops first
+			stack.push_back({ e->mid, ab.second });
+			stack.push_back({ ab.first, e->mid });
+		}
+	}
+
+public:
+	std::vector<Node*> nodes;
+	NodeIndex node_index;
+
+	int size() const { return rank.size(); }
+	int numShortcuts() const { return num_shortcuts; }
+
+	size_t memoryUsage() const
+	{
+		return (up_offsets.capacity() + down_offsets.capacity() + rank.capacity()) * sizeof(int) +
+			(up_edges.capacity() + down_edges.capacity()) * sizeof(Edge) + pos.capacity() * sizeof(cmn::vf3d) +
+			nodes.capacity() * sizeof(Node*) + node_index.memoryUsage();
+	}
+
+	//priorities are estimated in parallel on pool, contraction itself is serial
+	static ContractionHierarchy build(const NavGraph& nav, BuildStats* stats = nullptr, int max_settled = 500,
+		ThreadPool& pool = ThreadPool::shared())
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		const int n = nav.size();
+		std::vector<std::vector<Edge>> out(n), in(n);
+		for (int i = 0; i < n; i++)
+		{
+			for (int e = nav.offsets[i]; e < nav.offsets[i + 1]; e++)
+			{
+				out[i].push_back({ nav.nbrs[e], nav.costs[e], -1 });
+				in[nav.nbrs[e]].push_back({ i, nav.costs[e], -1 });
+			}
+		}
+
+		const bool sym = nav.symmetric;
+		std::vector<int> deleted_nbrs(n, 0), level(n, 0);
+		std::vector<Scratch> scratch(pool.size());
+		for (auto& s : scratch) s.hops.assign(n, 0), s.target.assign(n, 0), s.via.assign(n, 0), s.pos = &nav.pos;
+
+		//edge difference + contracted neighbors + hierarchy depth,
+		//the last two keep contraction spread evenly over the map.
+		//the edge difference comes from the same witness search as the
+		//contraction, cut to two hops. a tiny settled limit is just as cheap
+		//but stops before reaching most of v's neighbors, so it counts
+		//nearly every pair and ranks by degree instead.
+		auto priority = [&](int v, Scratch& s) {
+			int added = contract(out, in, v, false, s, max_settled, 2, sym);
+			int removed = out[v].size() + in[v].size();
+			return float(2 * (added - removed) + deleted_nbrs[v] + level[v]);
+		};
+
+		std::vector<float> key(n);
+		std::vector<char> stale(n, 0);
+		pool.parallelFor(n, [&](int v, int worker) { key[v] = priority(v, scratch[worker]); }, 64);
+
+		ContractionHierarchy ch;
+		ch.nodes = nav.nodes;
+		ch.pos = nav.pos;
+		ch.node_index = nav.node_index;
+		ch.rank.assign(n, 0);
+		std::vector<std::vector<Edge>> up(n), down(n);
+
+		//ties go to the lower index so a round is never empty
+		auto isMin = [&](int v) {
+			auto beats = [&](const std::vector<Edge>& edges) {
+				for (const auto& e : edges)
+				{
+					if (key[e.to] < key[v] || (key[e.to] == key[v] && e.to < v)) return false;
+				}
+				return true;
+			};
+			return beats(out[v]) && beats(in[v]);
+		};
+
+		//contract in rounds: every node whose key beats all its neighbors
+		//goes at once. none of a round are adjacent, so contracting one
+		//doesnt change what the others need.
+		//a touched neighbor only gets its two cheap terms bumped and is
+		//marked stale, the witness searches are redone once it is a
+		//candidate. redoing every touched node each round cost several
+		//times the contraction itself on mesh-like graphs.
+		std::vector<int> live(n), batch, refresh, touched;
+		for (int v = 0; v < n; v++) live[v] = v;
+		int r = 0;
+		while (live.size())
+		{
+			batch.clear();
+			refresh.clear();
+			for (const auto& v : live)
+			{
+				if (!isMin(v)) continue;
+				batch.push_back(v);
+				if (stale[v]) refresh.push_back(v);
+			}
+			pool.parallelFor(refresh.size(), [&](int i, int worker) {
+				key[refresh[i]] = priority(refresh[i], scratch[worker]);
+				stale[refresh[i]] = 0;
+			}, 16);
+			if (refresh.size()) batch.erase(std::remove_if(batch.begin(), batch.end(), [&](int v) { return !isMin(v); }), batch.end());
+
+			touched.clear();
+			for (const auto& v : batch)
+			{
+				//bounded like the estimates, with more hops. two hops here
+				//doubles the shortcuts on grids, past five adds almost none.
+				ch.num_shortcuts += contract(out, in, v, true, scratch[0], max_settled, 5, sym);
+				ch.rank[v] = r++;
+
+				//whatever is still live outranks v, then drop v from the live graph
+				int first = touched.size();
+				for (const auto& e : out[v])
+				{
+					up[v].push_back(e);
+					removeEdgesTo(in[e.to], v);
+					touched.push_back(e.to);
+				}
+				for (const auto& e : in[v])
+				{
+					down[v].push_back(e);
+					removeEdgesTo(out[e.to], v);
+					touched.push_back(e.to);
+				}
+				std::sort(touched.begin() + first, touched.end());
+				touched.erase(std::unique(touched.begin() + first, touched.end()), touched.end());
+				for (int i = first; i < (int)touched.size(); i++)
+				{
+					int t = touched[i], old_level = level[t];
+					deleted_nbrs[t]++;
+					level[t] = std::max(level[t], level[v] + 1);
+					key[t] += 1 + level[t] - old_level;
+					stale[t] = 1;
+				}
+
+				//free as we go
+				std::vector<Edge>().swap(out[v]);
+				std::vector<Edge>().swap(in[v]);
+				key[v] = INFINITY;
+			}
+
+			live.erase(std::remove_if(live.begin(), live.end(), [&](int v) { return key[v] == INFINITY; }), live.end());
+		}
+
+		for (int v = 0; v < n; v++)
+		{
+			ch.up_edges.insert(ch.up_edges.end(), up[v].begin(), up[v].end());
+			ch.up_offsets.push_back(ch.up_edges.size());
+			ch.down_edges.insert(ch.down_edges.end(), down[v].begin(), down[v].end());
+			ch.down_offsets.push_back(ch.down_edges.size());
+		}
+
+		ch.up_edges.shrink_to_fit();
+		ch.down_edges.shrink_to_fit();
+
+		if (stats)
+		{
+			stats->shortcuts = ch.num_shortcuts;
+			stats->ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		return ch;
+	}
+
+	//upward a* from both ends, each toward the other end, best meeting node wins.
+	//links never cost less than their length, so shortcuts dont either and
+	//the straight line stays a consistent bound on the upward graph.
+	//each side stops once its smallest key can't beat the best found,
+	//which drops the parts of the hierarchy that lead away from the goal.
+	[[nodiscard]] std::vector<int> route(int from, int to, SearchContext& ctx) const
+	{
+		SearchContext& bwd = ctx.reverse();
+		ctx.begin(size());
+		bwd.begin(size());
+		if (from < 0 || to < 0 || from >= size() || to >= size() || from == to) return {};
+
+		float h = (pos[from] - pos[to]).mag();
+		ctx.visit(from, 0, -1);
+		ctx.open.push(from, h);
+		bwd.visit(to, 0, -1);
+		bwd.open.push(to, h);
+
+		float best = INFINITY;
+		int meet = -1;
+
+		//stall on demand: if a higher ranked node already reached curr cheaper
+		//through an edge we dont search (it points down), curr cant be on a
+		//shortest up-down path, so dont grow from it.
+		auto step = [&](SearchContext& me, const SearchContext& other,
+			const std::vector<int>& off, const std::vector<Edge>& edges,
+			const std::vector<int>& stall_off, const std::vector<Edge>& stall_edges, int goal) {
+			int curr = me.open.pop();
+			me.close(curr);
+			ctx.stats.expanded++;
+
+			if (other.isSeen(curr) && me.g_cost[curr] + other.g_cost[curr] < best)
+			{
+				best = me.g_cost[curr] + other.g_cost[curr];
+				meet = curr;
+			}
+
+			for (int i = stall_off[curr]; i < stall_off[curr + 1]; i++)
+			{
+				const Edge& e = stall_edges[i];
+				if (me.isSeen(e.to) && me.g_cost[e.to] + e.cost < me.g_cost[curr]) return;
+			}
+
+			for (int i = off[curr]; i < off[curr + 1]; i++)
+			{
+				const Edge& e = edges[i];
+				if (me.isClosed(e.to)) continue;
+				float g = me.g_cost[curr] + e.cost;
+				bool in_open = me.isSeen(e.to);
+				if (!in_open || g < me.g_cost[e.to])
+				{
+					me.visit(e.to, g, curr);
+					float f = g + (pos[e.to] - pos[goal]).mag();
+					if (in_open) me.open.decrease(e.to, f);
+					else me.open.push(e.to, f);
+				}
+			}
+		};
+
+		for (;;)
+		{
+			bool fwd_live = !ctx.open.empty() && ctx.open.topKey() < best;
+			bool bwd_live = !bwd.open.empty() && bwd.open.topKey() < best;
+			if (!fwd_live && !bwd_live) break;
+
+			if (fwd_live && (!bwd_live || ctx.open.topKey() <= bwd.open.topKey())) step(ctx, bwd, up_offsets, up_edges, down_offsets, down_edges, to);
+			else step(bwd, ctx, down_offsets, down_edges, up_offsets, up_edges, from);
+		}
+
+		if (meet < 0) return {};
+
+		//up path from -> meet, then meet -> to down the other side
+		std::vector<int> hops = ctx.tracePath(meet);
+		for (int curr = bwd.parent[meet]; curr != -1; curr = bwd.parent[curr])
+		{
+			hops.push_back(curr);
+		}
+
+		std::vector<int> path{ hops.front() };
+		for (int i = 1; i < (int)hops.size(); i++)
+		{
+			unpack(hops[i - 1], hops[i], path);
+		}
+
+		return path;
+	}
+
+	//one side of a query on its own, run to the end: upward dijkstra from
+	//src, or backward down the down edges with reverse. visit(v, d) for
+	//each settled node that wasnt stalled. any shortest path a -> b has
+	//its top node in both a's forward and b's reverse visits, which is
+	//what the many-to-many tables in DistanceTable.h match up.
+	template<typename F>
+	void searchUp(int src, bool reverse, SearchContext& ctx, F visit) const
+	{
+		ctx.begin(size());
+		if (src < 0 || src >= size()) return;
+
+		const std::vector<int>& off = reverse ? down_offsets : up_offsets;
+		const std::vector<Edge>& edges = reverse ? down_edges : up_edges;
+		const std::vector<int>& stall_off = reverse ? up_offsets : down_offsets;
+		const std::vector<Edge>& stall_edges = reverse ? up_edges : down_edges;
+
+		ctx.visit(src, 0, -1);
+		ctx.open.push(src, 0);
+		while (!ctx.open.empty())
+		{
+			int curr = ctx.open.pop();
+			ctx.close(curr);
+			ctx.stats.expanded++;
+
+			bool stalled = false;
+			for (int i = stall_off[curr]; i < stall_off[curr + 1] && !stalled; i++)
+			{
+				const Edge& e = stall_edges[i];
+				stalled = ctx.isSeen(e.to) && ctx.g_cost[e.to] + e.cost < ctx.g_cost[curr];
+			}
+			if (stalled) continue;
+
+			visit(curr, ctx.g_cost[curr]);
+
+			for (int i = off[curr]; i < off[curr + 1]; i++)
+			{
+				const Edge& e = edges[i];
+				if (ctx.isClosed(e.to)) continue;
+				float g = ctx.g_cost[curr] + e.cost;
+				bool in_open = ctx.isSeen(e.to);
+				if (!in_open || g < ctx.g_cost[e.to])
+				{
+					ctx.visit(e.to, g, curr);
+					if (in_open) ctx.open.decrease(e.to, g);
+					else ctx.open.push(e.to, g);
+				}
+			}
+		}
+	}
+
+	[[nodiscard]] std::vector<Node*> route(Node* from, Node* to, RouteStats* stats = nullptr) const
+	{
+		std::vector<Node*> path;
+		int f = indexOf(from), t = indexOf(to);
+
+		SearchContext& ctx = SearchContext::local();
+		for (const auto& i : route(f, t, ctx))
+		{
+			path.push_back(nodes[i]);
+		}
+		if (stats) *stats = ctx.stats;
+
+		return path;
+	}
+
+	//same lookup as the NavGraph it was built from, see NodeIndex
+	int indexOf(const Node* n) const { return node_index.find(n); }
+};
+#endif//CONTRACTION_HIERARCHY_CLASS_H
@@ -0,0 +1,398 @@
+#pragma once
+#ifndef COOPERATIVE_PLANNER_CLASS_H
+#define COOPERATIVE_PLANNER_CLASS_H
+
+#include "NavGraph.h"
+#include "SearchContext.h"
+#include "ReservationTable.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct CooperativeOptions
+{
+	//ticks each agent plans and reserves ahead
+	int window = 16;
+	//ticks between replans in update(), at most window
+	int replan_every = 8;
+	//agents searching in parallel against the same table
+	int batch_size = 64;
+	//cost of standing still for a tick away from the goal, <= 0 picks the mean link cost.
+	//waiting at the goal is free.
+	float wait_cost = 0;
+	//for the guide paths, see CooperativePlanner. landmarks help, mode and smoothing are ignored
+	RouteOptions route;
+};
+
+struct CooperativeStats
+{
+	int planned = 0;
+	//parallel plans that clashed with an earlier commit in their batch
+	int retried = 0;
+	//agents boxed in before the window ends, planned as far as they could go
+	int stuck = 0;
+	//guide paths searched, see CooperativePlanner
+	int guided = 0;
+	long long expanded = 0;
+	double ms = 0;
+};
+
+//windowed cooperative A* (WHCA*, Silver 2005) for agents sharing a graph.
+//time runs in ticks, and every tick an agent either waits or takes one link.
+//each agent searches space-time (node, tick) states window ticks deep,
+//around whatever earlier agents reserved, then reserves its own plan,
+//so later agents route around it instead of through it.
+//
+//past the window each agent follows a guide, its own A* path ignoring
+//everyone else (silver uses a reverse search per goal, RRA*, for the same
+//true distance). the window aims at the guide node window steps ahead,
+//and the estimate adds what the guide has left from there. a straight line
+//estimate alone walks crowds into dead ends no window sees out of.
+//agents pushed more than half a window off their guide get a new one.
+//
+//plan() replans everyone: agents go in batches, a batch searches in
+//parallel against the table as the earlier batches left it, then commits
+//in order. a plan that clashes with one committed ahead of it in the
+//same batch is searched again on the spot. the agent order rotates
+//every plan(), so the same agents arent always the ones giving way.
+//
+//moves take a tick whatever the link costs, which suits waypoints spread
+//about evenly (poisson disc). link costs still rank the plans.
+class CooperativePlanner
+{
+public:
+	//last plan()
+	CooperativeStats stats;
+
+private:
+	std::shared_ptr<const NavGraph> nav;
+	CooperativeOptions opts;
+	ReservationTable table;
+	float wait_cost = 1;
+	//mean link length, for how far off its guide an agent is
+	float step = 1;
+
+	uint32_t tick = 0, planned_at = 0;
+	//ticks the shortest plan covers, update() replans before it runs out
+	uint32_t horizon = 1;
+	bool fresh = false;
+	int first_in_order = 0;
+
+	//per agent. plans[a][d] is where a is at tick planned_at + d
+	std::vector<int> at, goal;
+	std::vector<std::vector<int>> plans;
+	//guide path, cost left from each of its nodes, where the agent is along it,
+	//replans in a row it spent off the guide without getting further along
+	std::vector<std::vector<int>> guides;
+	std::vector<std::vector<float>> guide_left;
+	std::vector<int> along, stalled;
+
+	float linkCost(int u, int v) const
+	{
+		for (int e = nav->offsets[u]; e < nav->offsets[u + 1]; e++)
+		{
+			if (nav->nbrs[e] == v) return nav->costs[e];
+		}
+		return (nav->pos[u] - nav->pos[v]).mag();
+	}
+
+	//new guide from where a is now. false if there is no path.
+	bool guide(int a, SearchContext& ctx)
+	{
+		auto& path = guides[a];
+		auto& left = guide_left[a];
+		path = at[a] == goal[a] ? std::vector<int>{ at[a] } : nav->routeAStar(at[a], goal[a], ctx, opts.route);
+		along[a] = 0;
+		stalled[a] = 0;
+		left.assign(path.size(), 0);
+		for (int k = (int)path.size() - 2; k >= 0; k--) left[k] = left[k + 1] + linkCost(path[k], path[k + 1]);
+		return path.size() > 0;
+	}
+
+	//moves along[a] up to the guide node nearest a, within two windows.
+	//reguides when that is too far off, or when a is stuck off the guide,
+	//say behind a wall from it. returns the guide searches made.
+	int follow(int a, SearchContext& ctx)
+	{
+		const auto& path = guides[a];
+		if (path.empty() || path.back() != goal[a]) return guide(a, ctx), 1;
+
+		const cmn::vf3d& p = nav->pos[at[a]];
+		int best = along[a];
+		float best_dist = INFINITY;
+		const int end = std::min<int>(path.size(), along[a] + 2 * opts.window + 1);
+		for (int k = along[a]; k < end; k++)
+		{
+			float dist = (nav->pos[path[k]] - p).mag();
+			if (dist < best_dist) best_dist = dist, best = k;
+		}
+		if (best_dist > .5f * opts.window * step) return guide(a, ctx), 1;
+
+		if (path[best] == at[a] || best > along[a]) stalled[a] = 0;
+		else if (++stalled[a] > 1) return guide(a, ctx), 1;
+		along[a] = best;
+		return 0;
+	}
+
+	float heuristic(int a, int v, int aim) const
+	{
+		const auto& path = guides[a];
+		if (aim < 0) return nav->estimate(v, goal[a], opts.route);
+		return (nav->pos[v] - nav->pos[path[aim]]).mag() + guide_left[a][aim];
+	}
+
+	//space-time A* for agent a from tick, reading the table only.
+	//states are depth * n + node. false if every way ends before the window
+	//does, then out goes as deep as it could, which is a tick at least
+	//since plan() holds everyone's spot for tick + 1.
+	bool search(int a, SearchContext& ctx, std::vector<int>& out) const
+	{
+		const int n = nav->size();
+		const int w = opts.window;
+		const int from = at[a], to = goal[a];
+		//no guide means no path, then the estimate at least keeps a near
+		const int aim = guides[a].empty() ? -1 : std::min<int>(guides[a].size() - 1, along[a] + w);
+
+		ctx.begin(n * (w + 1));
+		ctx.visit(from, 0, -1);
+		ctx.open.push(from, heuristic(a, from, aim));
+
+		int end = -1, deepest = from;
+		while (!ctx.open.empty())
+		{
+			int s = ctx.open.pop();
+			ctx.close(s);
+			ctx.stats.expanded++;
+
+			const int v = s % n, d = s / n;
+			if (d > deepest / n) deepest = s;
+			//first state at the horizon has the best g + estimate left
+			if (d == w)
+			{
+				end = s;
+				break;
+			}
+
+			const uint32_t t = tick + d;
+			auto relax = [&](int u, float c) {
+				int next = (d + 1) * n + u;
+				if (ctx.isClosed(next)) return;
+				if (!table.nodeFree(u, t + 1, a)) return;
+				if (u != v && !table.linkFree(v, u, t, a)) return;
+
+				float g = ctx.g_cost[s] + c;
+				bool in_open = ctx.isSeen(next);
+				if (!in_open || g < ctx.g_cost[next])
+				{
+					ctx.visit(next, g, s);
+					float f = g + heuristic(a, u, aim);
+					if (in_open) ctx.open.decrease(next, f);
+					else ctx.open.push(next, f);
+				}
+			};
+
+			relax(v, v == to ? 0 : wait_cost);
+			for (int e = nav->offsets[v]; e < nav->offsets[v + 1]; e++) relax(nav->nbrs[e], nav->costs[e]);
+		}
+
+		out.clear();
+		for (int s = end < 0 ? deepest : end; s != -1; s = ctx.parent[s]) out.push_back(s % n);
+		std::reverse(out.begin(), out.end());
+		return end >= 0;
+	}
+
+	//does a's plan run into what is reserved already
+	bool clashes(int a) const
+	{
+		const auto& p = plans[a];
+		for (int d = 1; d < (int)p.size(); d++)
+		{
+			if (!table.nodeFree(p[d], tick + d, a)) return true;
+			if (p[d] != p[d - 1] && !table.linkFree(p[d - 1], p[d], tick + d - 1, a)) return true;
+		}
+		return false;
+	}
+
+	void reserve(int a)
+	{
+		const auto& p = plans[a];
+		for (int d = 0; d < (int)p.size(); d++)
+		{
+			table.reserveNode(p[d], tick + d, a);
+			if (d > 0 && p[d] != p[d - 1]) table.reserveLink(p[d - 1], p[d], tick + d - 1, a);
+		}
+	}
+
+public:
+	CooperativePlanner() {}
+
+	//drops every agent. nav is kept alive for as long as this uses it.
+	void reset(std::shared_ptr<const NavGraph> snapshot, const CooperativeOptions& options = {})
+	{
+		nav = std::move(snapshot);
+		opts = options;
+		opts.window = std::max(1, opts.window);
+		opts.replan_every = std::max(1, std::min(opts.replan_every, opts.window));
+		opts.batch_size = std::max(1, opts.batch_size);
+
+		wait_cost = opts.wait_cost;
+		if (wait_cost <= 0)
+		{
+			double sum = 0;
+			for (const auto& c : nav->costs) sum += c;
+			wait_cost = nav->numEdges() ? sum / nav->numEdges() : 1;
+		}
+		double length = 0;
+		for (int v = 0; v < nav->size(); v++)
+		{
+			for (int e = nav->offsets[v]; e < nav->offsets[v + 1]; e++) length += (nav->pos[v] - nav->pos[nav->nbrs[e]]).mag();
+		}
+		step = nav->numEdges() ? length / nav->numEdges() : 1;
+
+		at.clear(), goal.clear(), plans.clear();
+		guides.clear(), guide_left.clear(), along.clear(), stalled.clear();
+		table.clear();
+		tick = planned_at = 0;
+		horizon = 1;
+		fresh = false;
+		first_in_order = 0;
+		stats = {};
+	}
+
+	static CooperativePlanner make(std::shared_ptr<const NavGraph> snapshot, const CooperativeOptions& options = {})
+	{
+		CooperativePlanner p;
+		p.reset(std::move(snapshot), options);
+		return p;
+	}
+
+	//-1 if either node is outside the snapshot. plans on the next plan()/update().
+	int addAgent(int from, int to)
+	{
+		if (!nav || from < 0 || to < 0 || from >= nav->size() || to >= nav->size()) return -1;
+		at.push_back(from);
+		goal.push_back(to);
+		plans.push_back({ from });
+		guides.emplace_back();
+		guide_left.emplace_back();
+		along.push_back(0);
+		stalled.push_back(0);
+		fresh = false;
+		return at.size() - 1;
+	}
+
+	int addAgent(const Node* from, const Node* to)
+	{
+		return nav ? addAgent(nav->indexOf(from), nav->indexOf(to)) : -1;
+	}
+
+	void setGoal(int a, int to)
+	{
+		if (to < 0 || to >= nav->size()) return;
+		goal[a] = to;
+		guides[a].clear();
+		fresh = false;
+	}
+
+	int numAgents() const { return at.size(); }
+	uint32_t currentTick() const { return tick; }
+
+	int position(int a) const { return at[a]; }
+	int goalOf(int a) const { return goal[a]; }
+	bool arrived(int a) const { return at[a] == goal[a]; }
+
+	//nodes from the last plan(), one per tick starting at plannedAt()
+	const std::vector<int>& planOf(int a) const { return plans[a]; }
+	uint32_t plannedAt() const { return planned_at; }
+
+	const ReservationTable& reservations() const { return table; }
+	const NavGraph& graph() const { return *nav; }
+
+	//replans every agent from the current tick
+	void plan(ThreadPool& pool = ThreadPool::shared())
+	{
+		auto begin = std::chrono::high_resolution_clock::now();
+		stats = {};
+		table.clear();
+
+		const int num = at.size();
+		//everyone holds their spot for now and the next tick, so nobody
+		//gets planned into an agent that hasnt had its turn yet
+		for (int a = 0; a < num; a++)
+		{
+			table.reserveNode(at[a], tick, a);
+			table.reserveNode(at[a], tick + 1, a);
+		}
+
+		std::vector<int> order(num);
+		for (int k = 0; k < num; k++) order[k] = (first_in_order + k) % num;
+		first_in_order = num ? (first_in_order + opts.batch_size) % num : 0;
+
+		std::vector<RouteStats> per_worker(pool.size());
+		std::vector<int> guided(pool.size(), 0);
+		std::vector<char> found(num, 1);
+		for (int b = 0; b < num; b += opts.batch_size)
+		{
+			const int e = std::min(num, b + opts.batch_size);
+			pool.parallelFor(e - b, [&](int k, int worker) {
+				int a = order[b + k];
+				SearchContext& ctx = SearchContext::local();
+				if (follow(a, ctx))
+				{
+					guided[worker]++;
+					per_worker[worker].expanded += ctx.stats.expanded;
+				}
+				found[a] = search(a, ctx, plans[a]);
+				per_worker[worker].expanded += ctx.stats.expanded;
+			}, 1);
+
+			for (int k = b; k < e; k++)
+			{
+				int a = order[k];
+				if (clashes(a))
+				{
+					SearchContext& ctx = SearchContext::local();
+					found[a] = search(a, ctx, plans[a]);
+					stats.expanded += ctx.stats.expanded;
+					stats.retried++;
+				}
+				reserve(a);
+			}
+		}
+
+		for (const auto& s : per_worker) stats.expanded += s.expanded;
+		for (const auto& g : guided) stats.guided += g;
+		for (const auto& f : found) stats.stuck += !f;
+		stats.planned = num;
+		horizon = opts.replan_every;
+		for (const auto& p : plans) horizon = std::min<uint32_t>(horizon, std::max<int>(1, p.size() - 1));
+		stats.ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+		planned_at = tick;
+		fresh = true;
+	}
+
+	//one tick: everyone takes the next step of their plan
+	void advance()
+	{
+		const int d = tick + 1 - planned_at;
+		for (int a = 0; a < (int)at.size(); a++)
+		{
+			if (d < (int)plans[a].size()) at[a] = plans[a][d];
+		}
+		tick++;
+	}
+
+	//replans when due, when a short plan runs out, or after agents
+	//or goals changed, then advances
+	void update(ThreadPool& pool = ThreadPool::shared())
+	{
+		if (!fresh || tick - planned_at >= horizon) plan(pool);
+		advance();
+	}
+};
+#endif//COOPERATIVE_PLANNER_CLASS_H
@@ -0,0 +1,228 @@
+#pragma once
+#ifndef D_STAR_LITE_CLASS_H
+#define D_STAR_LITE_CLASS_H
+
+#include "DynamicNavGraph.h"
+#include "IndexedHeap.h"
+#include "SearchContext.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+//D* Lite (Koenig & Likhachev), one per agent.
+//searches backwards from the goal, so g(s) is the cost from s to the goal
+//and the agent can keep walking while edges change around it.
+//replan() reads only the log entries added since the last call and
+//repairs the part of the search tree they touch, instead of starting over.
+//g/rhs live for the planner's lifetime, so memory is O(nodes) per agent.
+class DStarLite
+{
+public:
+	//compared lexicographically
+	struct Key
+	{
+		float k1, k2;
+
+		bool operator<(const Key& o) const { return k1 != o.k1 ? k1 < o.k1 : k2 < o.k2; }
+		bool operator!=(const Key& o) const { return k1 != o.k1 || k2 != o.k2; }
+	};
+
+private:
+	const DynamicNavGraph* graph = nullptr;
+	int start = -1, goal = -1, last = -1;
+	float km = 0;
+
+	std::vector<float> g, rhs;
+	BasicIndexedHeap<Key> open;
+	size_t seen_changes = 0;
+	//the goal was unreachable at the last plan/replan
+	bool cut_off = false;
+
+	float h(int a, int b) const { return (graph->base().pos[a] - graph->base().pos[b]).mag(); }
+
+	Key calcKey(int s) const
+	{
+		float m = std::min(g[s], rhs[s]);
+		return { m + h(start, s) + km, m };
+	}
+
+	float bestSucc(int u) const
+	{
+		float best = INFINITY;
+		graph->forEachOut(u, [&](int v, float c) { best = std::min(best, c + g[v]); });
+		return best;
+	}
+
+	void updateVertex(int u)
+	{
+		bool queued = open.contains(u);
+		if (g[u] != rhs[u]) open.update(u, calcKey(u));
+		else if (queued) open.remove(u);
+	}
+
+	void computeShortestPath()
+	{
+		while (!open.empty() && (open.topKey() < calcKey(start) || rhs[start] > g[start]))
+		{
+			int u = open.top();
+			Key k_old = open.topKey();
+			Key k_new = calcKey(u);
+			stats.expanded++;
+
+			if (k_old < k_new)
+			{
+				open.update(u, k_new);
+			}
+			else if (g[u] > rhs[u])
+			{
+				//overconsistent, settle it like dijkstra would
+				g[u] = rhs[u];
+				open.remove(u);
+				graph->forEachIn(u, [&](int s, float c) {
+					if (s == goal) return;
+					rhs[s] = std::min(rhs[s], c + g[u]);
+					updateVertex(s);
+				});
+			}
+			else
+			{
+				//underconsistent, raise it and anything that leaned on it
+				float g_old = g[u];
+				g[u] = INFINITY;
+				graph->forEachIn(u, [&](int s, float c) {
+					if (s != goal && rhs[s] == c + g_old) rhs[s] = bestSucc(s);
+					updateVertex(s);
+				});
+				if (u != goal) rhs[u] = bestSucc(u);
+				updateVertex(u);
+			}
+		}
+	}
+
+	void applyChange(const DynamicNavGraph::Change& c)
+	{
+		int u = c.from;
+		if (u == goal) return;
+		if (c.old_cost > c.new_cost) rhs[u] = std::min(rhs[u], c.new_cost + g[c.to]);
+		else if (rhs[u] == c.old_cost + g[c.to]) rhs[u] = bestSucc(u);
+		updateVertex(u);
+	}
+
+public:
+	//heap pops in the last plan/replan
+	RouteStats stats;
+
+	DStarLite() {}
+
+	//full plan from -> to. the goal is fixed for the planner's lifetime,
+	//call this again to change it.
+	void reset(const DynamicNavGraph& dyn, int from, int to)
+	{
+		graph = &dyn;
+		const int n = dyn.size();
+		start = last = from, goal = to;
+		km = 0;
+		cut_off = false;
+		g.assign(n, INFINITY);
+		rhs.assign(n, INFINITY);
+		open.reserve(n);
+		open.clear();
+		stats = {};
+		//earlier edits are already baked into the costs
+		seen_changes = dyn.numChanges();
+
+		if (from < 0 || to < 0 || from >= n || to >= n) return;
+		rhs[goal] = 0;
+		open.push(goal, calcKey(goal));
+		//cut off goals skip the search, replan() picks it up from the queue
+		//once they are reachable again
+		cut_off = !dyn.connected(from, to);
+		if (!cut_off) computeShortestPath();
+	}
+
+	static DStarLite make(const DynamicNavGraph& dyn, int from, int to)
+	{
+		DStarLite d;
+		d.reset(dyn, from, to);
+		return d;
+	}
+
+	//the agent moved, e.g. one step along path(). O(1), work happens in replan.
+	void moveTo(int s)
+	{
+		if (s >= 0 && s < (int)g.size()) start = s;
+	}
+
+	int current() const { return start; }
+	int target() const { return goal; }
+
+	size_t pendingChanges() const { return graph ? graph->numChanges() - seen_changes : 0; }
+
+	//folds in graph edits and start moves since the last call.
+	//work scales with how much of the tree the edits disturbed.
+	//returns false if the goal can no longer be reached.
+	bool replan()
+	{
+		stats = {};
+		if (!graph || start < 0 || goal < 0) return false;
+
+		if (start != last)
+		{
+			//queued keys were computed against the old start
+			km += h(last, start);
+			last = start;
+		}
+
+		bool cut = false;
+		const auto& log = graph->changes();
+		for (; seen_changes < log.size(); seen_changes++)
+		{
+			applyChange(log[seen_changes]);
+			cut |= std::isinf(log[seen_changes].new_cost);
+		}
+
+		//proving the goal gone through the queue floods its whole component.
+		//after a cut connected() redoes the components once, every planner
+		//on the graph asking after that gets it in O(1).
+		if ((cut || cut_off) && !graph->connected(start, goal))
+		{
+			cut_off = true;
+			return false;
+		}
+		cut_off = false;
+		computeShortestPath();
+		return !std::isinf(rhs[start]);
+	}
+
+	//cost from the current start to the goal as of the last replan
+	float cost() const { return start < 0 || cut_off ? INFINITY : rhs[start]; }
+
+	//greedy walk down g from the current start, empty if unreachable.
+	//only meaningful right after replan (or reset).
+	std::vector<int> path() const
+	{
+		std::vector<int> path;
+		if (start < 0 || goal < 0 || std::isinf(cost())) return path;
+
+		path.push_back(start);
+		for (int curr = start; curr != goal;)
+		{
+			int next = -1;
+			float best = INFINITY;
+			graph->forEachOut(curr, [&](int v, float c) {
+				if (c + g[v] < best) best = c + g[v], next = v;
+			});
+			if (next < 0 || path.size() > g.size()) return {};
+			path.push_back(next);
+			curr = next;
+		}
+		return path;
+	}
+
+	size_t memoryUsage() const
+	{
+		return (g.capacity() + rhs.capacity()) * sizeof(float) + g.capacity() * (sizeof(int) + sizeof(Key) + 2 * sizeof(int));
+	}
+};
+#endif//D_STAR_LITE_CLASS_H
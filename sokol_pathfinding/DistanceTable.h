@@ -0,0 +1,181 @@
+#pragma once
+#ifndef DISTANCE_TABLE_H
+#define DISTANCE_TABLE_H
+
+#include "Graph.h"
+#include "NavGraph.h"
+#include "ContractionHierarchy.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+//dense travel costs between every source and every target,
+//row per source, column per target. INFINITY where there is no path,
+//or where the source or target wasnt a node of the graph.
+struct DistanceTable
+{
+	int rows = 0, cols = 0;
+	std::vector<float> dist;
+
+	void reset(int num_rows, int num_cols)
+	{
+		rows = num_rows, cols = num_cols;
+		dist.assign((size_t)rows * cols, INFINITY);
+	}
+
+	float at(int s, int t) const { return dist[(size_t)s * cols + t]; }
+	float& at(int s, int t) { return dist[(size_t)s * cols + t]; }
+
+	const float* row(int s) const { return &dist[(size_t)s * cols]; }
+
+	size_t memoryUsage() const { return dist.capacity() * sizeof(float); }
+};
+
+//adds up per worker stats, same as routeBatch
+void sumWorkerStats(const std::vector<RouteStats>& per_worker, RouteStats* total)
+{
+	if (!total) return;
+	*total = {};
+	for (const auto& s : per_worker)
+	{
+		total->expanded += s.expanded;
+		total->los_checks += s.los_checks;
+	}
+}
+
+//one dijkstra per source instead of one search per pair: every settled
+//node is checked against all targets at once, and the search stops when
+//the last target it can reach settles. with fewer targets than sources it
+//searches backwards from each target instead. searches spread over pool,
+//each with its own thread_local SearchContext.
+DistanceTable distanceTable(const NavGraph& nav,
+	const std::vector<int>& sources, const std::vector<int>& targets,
+	ThreadPool& pool = ThreadPool::shared(), RouteStats* total = nullptr)
+{
+	DistanceTable table;
+	table.reset(sources.size(), targets.size());
+	if (table.dist.empty()) return table;
+
+	const bool backward = targets.size() < sources.size();
+	const std::vector<int>& from = backward ? targets : sources;
+	const std::vector<int>& to = backward ? sources : targets;
+
+	//node -> the columns it fills, chained for repeats
+	const int n = nav.size();
+	std::vector<int> first(n, -1), next(to.size(), -1);
+	std::vector<int> to_nodes;
+	for (int c = (int)to.size() - 1; c >= 0; c--)
+	{
+		int v = to[c];
+		if (v < 0 || v >= n) continue;
+		if (first[v] < 0) to_nodes.push_back(v);
+		next[c] = first[v];
+		first[v] = c;
+	}
+
+	std::vector<RouteStats> per_worker(pool.size());
+	pool.parallelFor(from.size(), [&](int i, int worker) {
+		int src = from[i];
+		int remaining = 0;
+		for (const auto& v : to_nodes) remaining += nav.connected(src, v);
+		if (remaining == 0) return;
+
+		SearchContext& ctx = SearchContext::local();
+		nav.dijkstra(src, ctx, backward, [&](int v) {
+			if (first[v] < 0) return true;
+			for (int c = first[v]; c >= 0; c = next[c])
+			{
+				if (backward) table.at(c, i) = ctx.g_cost[v];
+				else table.at(i, c) = ctx.g_cost[v];
+			}
+			return --remaining > 0;
+		});
+		per_worker[worker].expanded += ctx.stats.expanded;
+	});
+
+	sumWorkerStats(per_worker, total);
+	return table;
+}
+
+//bucket based many-to-many over a contraction hierarchy.
+//a reverse upward search from each target drops (target, distance)
+//into a bucket at every node it settles, then a forward upward search
+//from each source scans the buckets of the nodes it settles. both phases
+//run in parallel, only filling the buckets in between is serial.
+//upward searches only see a few hundred nodes, so this beats a dijkstra
+//per source by a wide margin once the hierarchy is built.
+DistanceTable distanceTable(const ContractionHierarchy& ch,
+	const std::vector<int>& sources, const std::vector<int>& targets,
+	ThreadPool& pool = ThreadPool::shared(), RouteStats* total = nullptr)
+{
+	DistanceTable table;
+	table.reset(sources.size(), targets.size());
+	if (table.dist.empty()) return table;
+	std::vector<RouteStats> per_worker(pool.size());
+
+	struct Entry
+	{
+		int col;
+		float dist;
+	};
+
+	//reverse search spaces, one per target
+	std::vector<std::vector<std::pair<int, float>>> spaces(targets.size());
+	pool.parallelFor(targets.size(), [&](int c, int worker) {
+		SearchContext& ctx = SearchContext::local();
+		ch.searchUp(targets[c], true, ctx, [&](int v, float d) { spaces[c].push_back({ v, d }); });
+		per_worker[worker].expanded += ctx.stats.expanded;
+	});
+
+	//counting sort them into buckets by node
+	const int n = ch.size();
+	std::vector<int> offsets(n + 1, 0);
+	for (const auto& s : spaces)
+	{
+		for (const auto& e : s) offsets[e.first + 1]++;
+	}
+	for (int v = 0; v < n; v++) offsets[v + 1] += offsets[v];
+
+	std::vector<Entry> buckets(offsets[n]);
+	std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (int c = 0; c < (int)spaces.size(); c++)
+	{
+		for (const auto& e : spaces[c]) buckets[fill[e.first]++] = { c, e.second };
+		std::vector<std::pair<int, float>>().swap(spaces[c]);
+	}
+
+	pool.parallelFor(sources.size(), [&](int r, int worker) {
+		SearchContext& ctx = SearchContext::local();
+		float* row = &table.at(r, 0);
+		ch.searchUp(sources[r], false, ctx, [&](int v, float d) {
+			for (int b = offsets[v]; b < offsets[v + 1]; b++)
+			{
+				row[buckets[b].col] = std::min(row[buckets[b].col], d + buckets[b].dist);
+			}
+		});
+		per_worker[worker].expanded += ctx.stats.expanded;
+	});
+
+	sumWorkerStats(per_worker, total);
+	return table;
+}
+
+//node flavored version, unknown nodes get INFINITY rows/columns.
+DistanceTable distanceTable(const Graph& graph,
+	const std::vector<Node*>& sources, const std::vector<Node*>& targets,
+	ThreadPool& pool = ThreadPool::shared(), RouteStats* total = nullptr)
+{
+	const NavGraph& nav = graph.freeze();
+
+	std::vector<int> s_idx, t_idx;
+	s_idx.reserve(sources.size());
+	t_idx.reserve(targets.size());
+	for (const auto& n : sources) s_idx.push_back(nav.indexOf(n));
+	for (const auto& n : targets) t_idx.push_back(nav.indexOf(n));
+
+	return distanceTable(nav, s_idx, t_idx, pool, total);
+}
+#endif//DISTANCE_TABLE_H
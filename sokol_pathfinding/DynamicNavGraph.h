@@ -0,0 +1,229 @@
+#pragma once
+#ifndef DYNAMIC_NAV_GRAPH_CLASS_H
+#define DYNAMIC_NAV_GRAPH_CLASS_H
+
+#include "NavGraph.h"
+#include "Components.h"
+
+#include <cmath>
+#include <vector>
+#include <utility>
+
+//editable costs on top of a frozen NavGraph, for incremental planners.
+//the csr arrays are shared and never written, this keeps its own copy of
+//the edge costs, blocked flags and any edges added later. every edit that
+//changes an effective edge cost is appended to a log, so each DStarLite
+//only has to look at the edges that changed since it last replanned.
+//when an obstacle lands, call removeNode(index) here instead of (or as
+//well as) Graph::removeNode, and only refreeze once the edits pile up.
+//connected() keeps components current too: edges that come back are
+//merged in right away, cuts only mark them stale, and they are redone
+//in one pass the next time someone asks.
+class DynamicNavGraph
+{
+public:
+	struct Change
+	{
+		int from, to;
+		float old_cost, new_cost;
+	};
+
+private:
+	const NavGraph* nav = nullptr;
+
+	//parallel to nav's out and in edge arrays
+	std::vector<float> out_costs, in_costs;
+	std::vector<bool> blocked;
+
+	//edges that were not in the freeze, allocated on first use
+	std::vector<std::vector<std::pair<int, float>>> extra_out, extra_in;
+
+	std::vector<Change> log;
+
+	//over usable edges, rebuilt lazily once something was cut
+	mutable DisjointSets sets;
+	mutable bool sets_stale = true;
+
+	void joined(int a, int b)
+	{
+		if (!sets_stale) sets.unite(a, b);
+	}
+
+	const std::vector<int>& inOffsets() const { return nav->symmetric ? nav->offsets : nav->rev_offsets; }
+	const std::vector<int>& inNbrs() const { return nav->symmetric ? nav->nbrs : nav->rev_nbrs; }
+
+	static std::pair<int, float>* find(std::vector<std::vector<std::pair<int, float>>>& extra, int a, int b)
+	{
+		if (extra.empty()) return nullptr;
+		for (auto& e : extra[a])
+		{
+			if (e.first == b) return &e;
+		}
+		return nullptr;
+	}
+
+	//raw cost ignoring blocked nodes, INFINITY if there is no such edge
+	float rawCost(int a, int b) const
+	{
+		for (int e = nav->offsets[a]; e < nav->offsets[a + 1]; e++)
+		{
+			if (nav->nbrs[e] == b) return out_costs[e];
+		}
+		if (!extra_out.empty())
+		{
+			for (const auto& e : extra_out[a])
+			{
+				if (e.first == b) return e.second;
+			}
+		}
+		return INFINITY;
+	}
+
+public:
+	//keeps a pointer to nav, which must outlive this and stay unchanged.
+	static DynamicNavGraph make(const NavGraph& nav)
+	{
+		DynamicNavGraph d;
+		d.nav = &nav;
+		d.out_costs = nav.costs;
+		d.in_costs = nav.symmetric ? nav.costs : nav.rev_costs;
+		d.blocked.assign(nav.size(), false);
+		return d;
+	}
+
+	const NavGraph& base() const { return *nav; }
+	int size() const { return nav ? nav->size() : 0; }
+
+	bool isBlocked(int i) const { return blocked[i]; }
+
+	//effective cost, INFINITY if missing, removed or touching a blocked node
+	float cost(int a, int b) const
+	{
+		if (blocked[a] || blocked[b]) return INFINITY;
+		return rawCost(a, b);
+	}
+
+	//fn(v, cost) for every usable edge u -> v
+	template<typename F>
+	void forEachOut(int u, F fn) const
+	{
+		if (blocked[u]) return;
+		for (int e = nav->offsets[u]; e < nav->offsets[u + 1]; e++)
+		{
+			int v = nav->nbrs[e];
+			if (!blocked[v] && !std::isinf(out_costs[e])) fn(v, out_costs[e]);
+		}
+		if (extra_out.empty()) return;
+		for (const auto& e : extra_out[u])
+		{
+			if (!blocked[e.first] && !std::isinf(e.second)) fn(e.first, e.second);
+		}
+	}
+
+	//fn(u, cost) for every usable edge u -> v
+	template<typename F>
+	void forEachIn(int v, F fn) const
+	{
+		if (blocked[v]) return;
+		const auto& off = inOffsets();
+		const auto& nb = inNbrs();
+		for (int e = off[v]; e < off[v + 1]; e++)
+		{
+			int u = nb[e];
+			if (!blocked[u] && !std::isinf(in_costs[e])) fn(u, in_costs[e]);
+		}
+		if (extra_in.empty()) return;
+		for (const auto& e : extra_in[v])
+		{
+			if (!blocked[e.first] && !std::isinf(e.second)) fn(e.first, e.second);
+		}
+	}
+
+	//cuts every edge in or out of i. O(degree).
+	void removeNode(int i)
+	{
+		if (i < 0 || i >= size() || blocked[i]) return;
+		forEachOut(i, [&](int v, float c) { log.push_back({ i, v, c, INFINITY }); });
+		forEachIn(i, [&](int u, float c) { log.push_back({ u, i, c, INFINITY }); });
+		blocked[i] = true;
+		sets_stale = true;
+	}
+
+	//undoes removeNode, e.g. once the obstacle moved on.
+	void restoreNode(int i)
+	{
+		if (i < 0 || i >= size() || !blocked[i]) return;
+		blocked[i] = false;
+		forEachOut(i, [&](int v, float c) { log.push_back({ i, v, INFINITY, c }); joined(i, v); });
+		forEachIn(i, [&](int u, float c) { log.push_back({ u, i, INFINITY, c }); joined(u, i); });
+	}
+
+	//one way edit. INFINITY deletes the edge, a missing edge gets inserted.
+	//costs below the straight line length break the planners' heuristic.
+	void setEdgeCost(int a, int b, float c)
+	{
+		if (a < 0 || b < 0 || a >= size() || b >= size() || a == b) return;
+		float old_cost = cost(a, b);
+
+		bool in_csr = false;
+		for (int e = nav->offsets[a]; e < nav->offsets[a + 1]; e++)
+		{
+			if (nav->nbrs[e] == b) out_costs[e] = c, in_csr = true;
+		}
+		if (in_csr)
+		{
+			const auto& off = inOffsets();
+			const auto& nb = inNbrs();
+			for (int e = off[b]; e < off[b + 1]; e++)
+			{
+				if (nb[e] == a) in_costs[e] = c;
+			}
+		}
+		else
+		{
+			if (extra_out.empty()) extra_out.resize(size()), extra_in.resize(size());
+			if (auto* e = find(extra_out, a, b)) e->second = c;
+			else extra_out[a].push_back({ b, c });
+			if (auto* e = find(extra_in, b, a)) e->second = c;
+			else extra_in[b].push_back({ a, c });
+		}
+
+		float new_cost = cost(a, b);
+		if (old_cost != new_cost) log.push_back({ a, b, old_cost, new_cost });
+
+		if (std::isinf(new_cost)) sets_stale |= !std::isinf(old_cost);
+		else joined(a, b);
+	}
+
+	//false means no path from a to b right now, as in NavGraph::connected.
+	//O(1) unless something was cut since the last call, then O(edges) once.
+	bool connected(int a, int b) const
+	{
+		if (a < 0 || b < 0 || a >= size() || b >= size()) return false;
+		if (blocked[a] || blocked[b]) return a == b;
+		if (sets_stale)
+		{
+			sets.reset(size());
+			for (int u = 0; u < size(); u++)
+			{
+				forEachOut(u, [&](int v, float) { sets.unite(u, v); });
+			}
+			sets_stale = false;
+		}
+		return sets.same(a, b);
+	}
+
+	//every effective cost change so far, oldest first
+	const std::vector<Change>& changes() const { return log; }
+	size_t numChanges() const { return log.size(); }
+
+	size_t memoryUsage() const
+	{
+		size_t total = (out_costs.capacity() + in_costs.capacity()) * sizeof(float) +
+			blocked.capacity() / 8 + log.capacity() * sizeof(Change) + sets.memoryUsage();
+		for (const auto& e : extra_out) total += e.capacity() * sizeof(std::pair<int, float>);
+		for (const auto& e : extra_in) total += e.capacity() * sizeof(std::pair<int, float>);
+		return total;
+	}
+};
+#endif//DYNAMIC_NAV_GRAPH_CLASS_H
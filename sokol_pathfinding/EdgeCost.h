@@ -0,0 +1,75 @@
+#pragma once
+#ifndef EDGE_COST_H
+#define EDGE_COST_H
+
+#include "math/v3d.h"
+#include "Node.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+//edge cost policies for NavGraph::makeFromNodes and Graph::setCostPolicy.
+//any callable float(const Node* a, const Node* b) works, called once
+//per link a -> b when the graph is frozen. searches only ever add up
+//the stored results. INFINITY (or nan) drops the link.
+//costs below the straight line length are raised to it,
+//the A* heuristic relies on never overestimating.
+
+//plain length, the default
+struct DistanceCost
+{
+	float operator()(const Node* a, const Node* b) const
+	{
+		return (b->pos - a->pos).mag();
+	}
+};
+
+//length scaled by the grade (rise over run) along the link, so climbing
+//costs extra and steep descents a little. waypoints sit on the terrain,
+//so the grade between two of them is what the terrain normals give
+//along that direction. links steeper than max_grade are dropped.
+struct SlopeCost
+{
+	float uphill = 2;
+	float downhill = .5f;
+	float max_grade = INFINITY;
+
+	float operator()(const Node* a, const Node* b) const
+	{
+		cmn::vf3d d = b->pos - a->pos;
+		float len = d.mag();
+		float run = std::sqrt(d.x * d.x + d.z * d.z);
+		if (run <= 0) return len;
+
+		float grade = d.y / run;
+		if (std::abs(grade) > max_grade) return INFINITY;
+		return len * (1 + (grade > 0 ? uphill * grade : -downhill * grade));
+	}
+};
+
+//length times a multiplier for the region the link's midpoint is in.
+//region(pos) gives an index into multipliers, out of range means 1.
+//a multiplier of INFINITY makes the region impassable.
+template<typename RegionFn>
+struct RegionCost
+{
+	RegionFn region;
+	std::vector<float> multipliers;
+
+	float operator()(const Node* a, const Node* b) const
+	{
+		float len = (b->pos - a->pos).mag();
+		int r = region((a->pos + b->pos) / 2);
+		if (r < 0 || r >= (int)multipliers.size()) return len;
+		return len * multipliers[r];
+	}
+};
+
+template<typename RegionFn>
+RegionCost<RegionFn> makeRegionCost(RegionFn region, std::vector<float> multipliers)
+{
+	return { std::move(region), std::move(multipliers) };
+}
+#endif//EDGE_COST_H
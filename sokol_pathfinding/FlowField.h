@@ -0,0 +1,169 @@
+#pragma once
+#ifndef FLOW_FIELD_CLASS_H
+#define FLOW_FIELD_CLASS_H
+
+#include "NavGraph.h"
+#include "SearchContext.h"
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//distance to one goal and the next hop towards it, for every node.
+//one reverse dijkstra from the goal replaces a route call per agent,
+//after that each agent just reads next[its node] every time it arrives.
+struct FlowField
+{
+	//snapshot this was built from, kept alive for node lookups
+	std::shared_ptr<const NavGraph> nav;
+	int goal = -1;
+
+	//INFINITY and -1 where the goal cant be reached
+	std::vector<float> dist;
+	std::vector<int> next;
+
+	int size() const { return dist.size(); }
+
+	bool reachable(int i) const { return i >= 0 && i < size() && !std::isinf(dist[i]); }
+
+	float distance(int i) const { return reachable(i) ? dist[i] : INFINITY; }
+
+	//-1 at the goal or if unreachable
+	int nextHop(int i) const { return i >= 0 && i < size() ? next[i] : -1; }
+
+	//node flavored lookup. nullptr at the goal, for unknown nodes,
+	//or for nodes the snapshot doesnt know (added after it was taken).
+	//goes through the snapshot's own node index, so it stays right and
+	//safe to call from any thread after the graph is frozen again.
+	Node* nextHop(const Node* n) const
+	{
+		if (!nav) return nullptr;
+		int i = nextHop(nav->indexOf(n));
+		return i < 0 ? nullptr : nav->nodes[i];
+	}
+
+	//full path from i, following next hops
+	std::vector<int> pathFrom(int i) const
+	{
+		std::vector<int> path;
+		if (!reachable(i)) return path;
+		for (int curr = i; curr != -1; curr = next[curr]) path.push_back(curr);
+		return path;
+	}
+
+	size_t memoryUsage() const { return dist.capacity() * sizeof(float) + next.capacity() * sizeof(int); }
+
+	//fills in place, so rebuilding a field for a new goal reuses its storage
+	void build(std::shared_ptr<const NavGraph> snapshot, int to, SearchContext& ctx)
+	{
+		nav = std::move(snapshot);
+		goal = to;
+		const int n = nav ? nav->size() : 0;
+		dist.assign(n, INFINITY);
+		next.assign(n, -1);
+		if (to < 0 || to >= n) return;
+
+		//reverse search tree: each node's parent is one step closer to the goal
+		nav->dijkstra(to, ctx, true);
+		for (int i = 0; i < n; i++)
+		{
+			if (!ctx.isSeen(i)) continue;
+			dist[i] = ctx.g_cost[i];
+			next[i] = ctx.parent[i];
+		}
+	}
+
+	static FlowField make(std::shared_ptr<const NavGraph> snapshot, int to)
+	{
+		FlowField f;
+		f.build(std::move(snapshot), to, SearchContext::local());
+		return f;
+	}
+};
+
+//double buffered flow field that rebuilds on a background thread.
+//readers grab current(), which only locks long enough to copy a pointer,
+//and can keep using that field for as long as they like while refresh()
+//builds the next one. the retired field's storage is reused next time
+//if nobody is holding it any more. refresh from one thread only.
+class AsyncFlowField
+{
+	std::shared_ptr<FlowField> front;
+	std::shared_ptr<FlowField> spare;
+	std::thread worker;
+	SearchContext worker_ctx;
+	std::atomic<bool> busy{ false };
+	std::mutex swap_mutex;
+
+	std::shared_ptr<FlowField> takeSpare()
+	{
+		std::lock_guard<std::mutex> lock(swap_mutex);
+		std::shared_ptr<FlowField> f;
+		if (spare && spare.use_count() == 1) f = std::move(spare);
+		spare.reset();
+		return f ? f : std::make_shared<FlowField>();
+	}
+
+	void publish(std::shared_ptr<FlowField> f)
+	{
+		std::lock_guard<std::mutex> lock(swap_mutex);
+		spare = std::move(front);
+		front = std::move(f);
+	}
+
+public:
+	AsyncFlowField() {}
+
+	AsyncFlowField(const AsyncFlowField&) = delete;
+	AsyncFlowField& operator=(const AsyncFlowField&) = delete;
+
+	~AsyncFlowField()
+	{
+		wait();
+	}
+
+	//latest finished field, nullptr before the first one lands.
+	std::shared_ptr<const FlowField> current()
+	{
+		std::lock_guard<std::mutex> lock(swap_mutex);
+		return front;
+	}
+
+	bool isRefreshing() const { return busy; }
+
+	//blocks until a running refresh has been published.
+	void wait()
+	{
+		if (worker.joinable()) worker.join();
+	}
+
+	//starts rebuilding towards goal on its own thread.
+	//returns false (and does nothing) if a refresh is still running.
+	//the snapshot is shared, so later graph edits dont disturb it.
+	bool refresh(std::shared_ptr<const NavGraph> nav, int goal)
+	{
+		if (busy) return false;
+		wait();
+		busy = true;
+		worker = std::thread([this, nav = std::move(nav), goal]() mutable {
+			std::shared_ptr<FlowField> f = takeSpare();
+			f->build(std::move(nav), goal, worker_ctx);
+			publish(std::move(f));
+			busy = false;
+		});
+		return true;
+	}
+
+	//same, on the calling thread.
+	void refreshNow(std::shared_ptr<const NavGraph> nav, int goal)
+	{
+		wait();
+		std::shared_ptr<FlowField> f = takeSpare();
+		f->build(std::move(nav), goal, SearchContext::local());
+		publish(std::move(f));
+	}
+};
+#endif//FLOW_FIELD_CLASS_H
@@ -1,16 +1,57 @@
 #pragma once
 #include "Node.h"
+#include "NavGraph.h"
+#include "SpatialIndex.h"
+#include "NavGraphFile.h"
+#include "return_code.h"
 
 #include <list>
+#include <vector>
+#include <algorithm>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <functional>
 
 class Graph
 {
-	void copyFrom(const Graph&), clear();
+	void copyFrom(const Graph&), clear(bool keep_list = false);
+
+	//every Node and every node's link array lives in these, see NodePool.h.
+	//declared before nodes, so they outlive them.
+	FixedPool node_pool{ sizeof(Node), alignof(Node) };
+	SpanPool link_pool{ sizeof(Node*), alignof(Node*) };
+
+	Node* makeNode(const cmn::vf3d& p)
+	{
+		return new (node_pool.allocate()) Node(p, &link_pool);
+	}
+
+	void destroyNode(Node* n)
+	{
+		n->~Node();
+		node_pool.deallocate(n);
+	}
+
+	mutable std::shared_ptr<const NavGraph> frozen;
+	mutable unsigned frozen_version = ~0u;
+	mutable std::mutex frozen_mutex;
+
+	//freeze with a cost policy, empty means DistanceCost
+	std::function<NavGraph(const std::list<Node*>&, NodeOrder)> builder;
+	NodeOrder node_order = ORDER_LIST;
+
+	//built on first use, then kept up to date by addNode/removeNode
+	mutable std::unique_ptr<SpatialIndex> spatial;
+	mutable std::mutex spatial_mutex;
 
 public:
+	//add with addNode, a Node from anywhere else would be freed wrong
 	std::list<Node*> nodes;
 
+	//bumped by every edit. if you touch nodes/links by hand, call markDirty().
+	unsigned version = 0;
+
 	Graph() {}
 
 	Graph(const Graph& g)
@@ -26,12 +67,28 @@ public:
 	Graph& operator=(const Graph& g)
 	{
 		if (&g == this) return *this;
-		clear();
+		clear(true);
 		copyFrom(g);
 
 		return *this;
 	}
 
+	void markDirty() { version++; }
+
+	//bytes held for nodes and links, live or not
+	size_t poolMemoryUsage() const
+	{
+		return node_pool.memoryUsage() + link_pool.memoryUsage();
+	}
+
+	Node* addNode(const cmn::vf3d& p)
+	{
+		nodes.push_back(makeNode(p));
+		version++;
+		if (spatial) spatial->insert(nodes.back());
+		return nodes.back();
+	}
+
 	bool contains(const Node* o) const
 	{
 		if (!o) return false;
@@ -52,14 +109,16 @@ public:
 		//does this graph have those nodes;
 		if (!contains(a) || !contains(b)) return false;
 
+		//already linked?
 		for (const auto& n : a->links)
 		{
 			if (n == b) return false;
+		}
 
-			a->links.emplace_back(b);
+		a->links.emplace_back(b);
+		version++;
 
-			return true;
-		}
+		return true;
 	}
 
 	void removeNode(Node* said)
@@ -72,144 +131,275 @@ public:
 			for (const auto& n : nodes)
 			{
 				auto nit = std::find(n->links.begin(), n->links.end(), said);
-				if (nit != nodes.end()) n->links.erase(nit);
+				if (nit != n->links.end()) n->links.erase(nit);
 			}
 
+			if (spatial) spatial->remove(*it);
+
 			//deallocate
-			delete* it;
+			destroyNode(*it);
 			//remove
 			nodes.erase(it);
+			version++;
 
 		}
 	}
 
-	//doesnt change structure pre se, but changes node values...(const-ish)
-	[[nodiscard]] std::vector<Node*> route(Node* from, Node* to) const
+	//edge costs for every later freeze, see EdgeCost.h. the policy is
+	//baked into a builder here, so it is inlined into the build loop.
+	//survives clear/load, and is copied along with the graph.
+	template<typename CostFn>
+	void setCostPolicy(CostFn cost)
 	{
-		std::vector<Node*> path;
-		if (!from || !to || from == to) return path;
+		builder = [cost](const std::list<Node*>& src, NodeOrder order) { return NavGraph::makeFromNodes(src, cost, order); };
+		version++;
+	}
 
-		from->g_cost = 0;
+	//back to plain lengths
+	void resetCostPolicy()
+	{
+		builder = nullptr;
+		version++;
+	}
 
-		for (const auto& n : nodes)
+	//how later freezes number the nodes, see NodeOrder.h. list order
+	//is left alone either way, only indexes and the csr arrays follow it.
+	//survives clear/load, and is copied along with the graph.
+	void setNodeOrder(NodeOrder order)
+	{
+		node_order = order;
+		version++;
+	}
+
+	NodeOrder nodeOrder() const { return node_order; }
+
+	//csr snapshot of the current nodes/links, rebuilt when the version moves on.
+	//safe to call from many threads, but not while someone is editing.
+	const NavGraph& freeze() const
+	{
+		return *snapshot();
+	}
+
+	//same snapshot, shared. it stays alive for whoever holds it after
+	//later edits replace it, so background work can keep reading it.
+	std::shared_ptr<const NavGraph> snapshot() const
+	{
+		std::lock_guard<std::mutex> lock(frozen_mutex);
+		if (!frozen || frozen_version != version)
 		{
-			//compute h costs
-			n->h_cost = (n->pos - to->pos).mag();
-			//reset parents
-			n->parent = nullptr;
+			//not made const, copyFrom may reuse it once nobody else holds it
+			frozen = std::make_shared<NavGraph>(builder ? builder(nodes, node_order) : NavGraph::makeFromNodes(nodes, DistanceCost{}, node_order));
+			frozen_version = version;
 		}
+		return frozen;
+	}
 
-		std::list<Node*> open{ from }, closed;
+	//writes nodes, links and edge costs in the binary format from NavGraphFile.h
+	[[nodiscard]] ReturnCode save(const std::string& filename) const
+	{
+		return saveNavGraph(freeze(), filename);
+	}
 
-		while (open.size())
+	//replaces everything with the graph in filename. nodes come back in
+	//saved order with the same links, the graph is left as is on failure.
+	//with no cost policy set it starts out frozen on the saved costs, as
+	//copyFrom does. a policy, set now or later, and any edit refreeze
+	//from the links, so after an edit plain lengths apply again.
+	[[nodiscard]] ReturnCode load(const std::string& filename)
+	{
+		MappedNavGraph file;
+		ReturnCode status = MappedNavGraph::open(file, filename);
+		if (!status.valid) return status;
+
+		const NavGraphView& view = file.view;
+		clear();
+		std::vector<Node*> made(view.size());
+		for (int i = 0; i < view.size(); i++)
 		{
-			//node in OPEN with lowest f_cost
-			float record = INFINITY;
-			auto curr_it = open.end();
-			for (auto oit = open.begin(); oit != open.end(); oit++)
+			made[i] = makeNode(view.pos(i));
+			nodes.push_back(made[i]);
+		}
+		for (int i = 0; i < view.size(); i++)
+		{
+			made[i]->links.reserve(view.offsets[i + 1] - view.offsets[i]);
+			for (int e = view.offsets[i]; e < view.offsets[i + 1]; e++)
 			{
-				const auto& o = *oit;
-				if (o->f_cost < record)
-				{
-					record = o->f_cost;
-					curr_it = oit;
-				}
+				made[i]->links.push_back(made[view.nbrs[e]]);
 			}
+		}
+		version++;
 
-			//remove from OPEN, add to CLOSED
-			open.erase(curr_it);
-			Node* curr = *curr_it;
-			closed.emplace_back(curr);
+		if (!builder)
+		{
+			auto nav = std::make_shared<NavGraph>(view.toNavGraph());
+			for (int i = 0; i < view.size(); i++) made[i]->id = i;
+			nav->nodes = std::move(made);
+			nav->node_index.build(nav->nodes);
+			frozen = std::move(nav);
+			frozen_version = version;
+		}
 
-			//path found
-			if (curr == to) break;
+		return status;
+	}
 
-			for (const auto& nbr : curr->links)
-			{
-				//skip if neighbor in CLOSED
-				bool found = false;
-				for (const auto& c : closed)
-				{
-					if (c == nbr)
-					{
-						found = true;
-						break;
-					}
-				}
-
-				if (found) continue;
-
-				//new path shorter OR neighbor NOT in OPEN
-				float new_g_cost = curr->g_cost + (nbr->pos - curr->pos).mag();
-				bool shorter = new_g_cost < nbr->g_cost;
-				bool in_open = false;
-				for (const auto& o : open)
-				{
-					if (o == nbr)
-					{
-						in_open = true;
-						break;
-					}
-				}
-
-				if (shorter || in_open)
-				{
-					nbr->g_cost = new_g_cost;
-					nbr->f_cost = nbr->g_cost + nbr->h_cost;
-					nbr->parent = curr;
-					if (!in_open) open.emplace_back(nbr);
-				}
-			}
+	//nearest waypoint lookups. same threading rules as freeze().
+	//if you move node positions by hand, call rebuildSpatialIndex().
+	const SpatialIndex& spatialIndex() const
+	{
+		std::lock_guard<std::mutex> lock(spatial_mutex);
+		if (!spatial)
+		{
+			spatial = std::make_unique<SpatialIndex>();
+			spatial->build(nodes.begin(), nodes.end());
 		}
+		return *spatial;
+	}
+
+	void rebuildSpatialIndex()
+	{
+		std::lock_guard<std::mutex> lock(spatial_mutex);
+		spatial.reset();
+	}
 
-		//traverse backwards
-		bool valid = false;
-		for (Node* curr = to; curr; curr = curr->parent)
+	//closest node to p within max_dist, or nullptr
+	Node* nearestNode(const cmn::vf3d& p, float max_dist = INFINITY) const
+	{
+		return spatialIndex().nearest(p, max_dist);
+	}
+
+	//false if no path from a to b can exist, see NavGraph::connected.
+	//components are labeled on freeze, so this is O(1) until the next edit.
+	bool connected(const Node* a, const Node* b) const
+	{
+		const NavGraph& nav = freeze();
+		return nav.connected(nav.indexOf(a), nav.indexOf(b));
+	}
+
+	//searches the frozen csr graph, maps the result back to nodes.
+	//nodes are never written to, so concurrent calls are fine.
+	[[nodiscard]] std::vector<Node*> route(Node* from, Node* to, SearchContext& ctx, const RouteOptions& opts = {}) const
+	{
+		std::vector<Node*> path;
+		ctx.stats = {};
+		if (!from || !to || from == to) return path;
+
+		const NavGraph& nav = freeze();
+		int f = nav.indexOf(from), t = nav.indexOf(to);
+		if (f < 0 || t < 0) return path;
+
+		for (const auto& i : nav.route(f, t, ctx, opts))
 		{
-			path.emplace_back(curr);
-			if (curr == from)
-			{
-				valid = true;
-				break;
-			}
+			path.push_back(nav.nodes[i]);
 		}
 
-		//ensure path contains to and from
-		if (valid) std::reverse(path.begin(), path.end());
-		else path.clear();
+		return path;
+	}
 
+	//uses this thread's scratch context.
+	[[nodiscard]] std::vector<Node*> route(Node* from, Node* to, RouteStats* stats = nullptr, const RouteOptions& opts = {}) const
+	{
+		SearchContext& ctx = SearchContext::local();
+		auto path = route(from, to, ctx, opts);
+		if (stats) *stats = ctx.stats;
 		return path;
 	}
 
+	//world positions, snapped to their nearest nodes.
+	[[nodiscard]] std::vector<Node*> route(const cmn::vf3d& from, const cmn::vf3d& to, RouteStats* stats = nullptr, const RouteOptions& opts = {}) const
+	{
+		return route(nearestNode(from), nearestNode(to), stats, opts);
+	}
+
 };
 
+//freeze numbers g's nodes (free if it is current), so links remap by
+//index instead of through a hash map. the clone's list comes out in
+//that index order, and it starts out frozen, with a copy of g's arrays
+//pointing at its own nodes. links to nodes outside g are dropped.
+//each clone gets its whole link array in one allocation, filled in one
+//pass over the csr arrays. whatever cells are left in the list, from
+//a clear(true), are written over before any new ones are made.
 void Graph::copyFrom(const Graph& g)
 {
-	//copy voer node positions
-	std::unordered_map<Node*, Node*> g2me;
-	for (const auto& gn : g.nodes)
+	std::shared_ptr<const NavGraph> src = g.snapshot();
+	const int n = src->size();
+
+	std::vector<Node*> made(n);
+	size_t num_links = 0;
+	auto cell = nodes.begin();
+	for (int i = 0; i < n; i++)
 	{
-		nodes.push_back(new Node(gn->pos));
-		g2me[gn] = nodes.back();
+		made[i] = makeNode(src->pos[i]);
+		made[i]->id = i;
+		if (cell != nodes.end()) *cell++ = made[i];
+		else nodes.push_back(made[i]);
+		num_links += src->nodes[i]->links.size();
 	}
+	nodes.erase(cell, nodes.end());
 
-	//copy over links
-	for (const auto& gn : g.nodes)
+	if (num_links == src->nbrs.size())
+	{
+		//every link made it into the csr arrays, in order.
+		//reading those beats chasing g's link lists around the heap
+		for (int i = 0; i < n; i++)
+		{
+			LinkArray& links = made[i]->links;
+			links.reserve(src->offsets[i + 1] - src->offsets[i]);
+			for (int e = src->offsets[i]; e < src->offsets[i + 1]; e++)
+			{
+				links.push_back(made[src->nbrs[e]]);
+			}
+		}
+	}
+	else
 	{
-		Node* n = g2me[gn];
-		for (const auto& go : gn->links)
+		//the cost policy dropped some, or some dangle
+		for (int i = 0; i < n; i++)
 		{
-			n->links.push_back(g2me[go]);
+			made[i]->links.reserve(src->nodes[i]->links.size());
+			for (const auto& l : src->nodes[i]->links)
+			{
+				int j = src->indexOf(l);
+				if (j >= 0) made[i]->links.push_back(made[j]);
+			}
 		}
 	}
+
+	builder = g.builder;
+	node_order = g.node_order;
+	version++;
+
+	//when only this graph holds its last snapshot, copy over that one.
+	//its arrays are sized and paged in already, fresh ones spent about
+	//as long faulting pages in as copying.
+	std::shared_ptr<NavGraph> nav;
+	if (frozen.use_count() == 1) nav = std::const_pointer_cast<NavGraph>(frozen);
+	else nav = std::make_shared<NavGraph>();
+	*nav = *src;
+	nav->nodes.assign(made.begin(), made.end());
+	nav->node_index.build(nav->nodes);
+	frozen = std::move(nav);
+	frozen_version = version;
 }
 
-void Graph::clear()
+//keep_list leaves the list cells in place, pointing at dead nodes,
+//for copyFrom to fill in again. a list cell is a malloc each.
+void Graph::clear(bool keep_list)
 {
-	for (const auto& n : nodes)
+	//nodes and their link arrays only own pool memory, so when every
+	//array came from the pool, dropping the pools frees them all at once.
+	//otherwise run the destructors to give the spilled ones back.
+	if (link_pool.numSpilled())
 	{
-		nodes.clear();
+		for (const auto& n : nodes)
+		{
+			destroyNode(n);
+		}
 	}
+	if (!keep_list) nodes.clear();
+	//keep the memory for whatever gets loaded or copied in next
+	node_pool.reset();
+	link_pool.reset();
+	spatial.reset();
+	version++;
 }
-
-
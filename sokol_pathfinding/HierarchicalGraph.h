@@ -0,0 +1,524 @@
+#pragma once
+#ifndef HIERARCHICAL_GRAPH_CLASS_H
+#define HIERARCHICAL_GRAPH_CLASS_H
+
+#include "NavGraph.h"
+#include "SearchContext.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+//HPA* style two level search over a frozen NavGraph.
+//nodes are bucketed into square xz clusters, and each cluster is split
+//into the parts its nodes form through links that stay inside it.
+//the nodes along a border that link into the same part of a neighbor
+//cluster form runs, and each run gets one entrance in its middle, or
+//one at each end if it is long. each cluster keeps a table of entrance
+//to entrance costs that stay inside the cluster, plus the shortest path
+//tree behind each row, so a query searches the small abstract graph
+//(entrances, tables, crossing links) and then reads each abstract hop
+//back off a tree without searching. crossing only at entrances costs a
+//few percent of path length against plain A*, in return for a far
+//smaller abstract graph. removeNode only rebuilds the clusters it touches.
+//runs and parts ignore link direction, so with one way links a failed
+//abstract search is double checked with a flat one.
+class HierarchicalGraph
+{
+	const NavGraph* nav = nullptr;
+
+	float cell = 1;
+	float min_x = 0, min_z = 0;
+	int cols = 0, rows = 0;
+
+	std::vector<int> cluster;
+	//part of its cluster each node is in, named by one of its nodes, -1 if blocked
+	std::vector<int> part;
+	std::vector<bool> blocked;
+	std::vector<std::vector<int>> members;
+	//index in its cluster's member list
+	std::vector<int> member_slot;
+	std::vector<std::vector<int>> entrances;
+	//k x k per cluster, row = from entrance slot
+	std::vector<std::vector<float>> tables;
+	//k x members per cluster, parent of each member on its shortest path from entrance row, -1 if none
+	std::vector<std::vector<int>> trees;
+	//slot in its cluster's entrance list, -1 if not an entrance
+	std::vector<int> slot;
+	//linked entrance pairs {a in c, b in a higher cluster} picked by cluster c
+	std::vector<std::vector<std::pair<int, int>>> borders;
+	//border pairs each node is part of, an entrance while above 0
+	std::vector<int> picks;
+	//run[i] == run_stamp while i is on the border being split into runs
+	std::vector<int> run;
+	int run_stamp = 0;
+
+	const std::vector<int>& inOffsets() const { return nav->symmetric ? nav->offsets : nav->rev_offsets; }
+	const std::vector<int>& inNbrs() const { return nav->symmetric ? nav->nbrs : nav->rev_nbrs; }
+	const std::vector<float>& inCosts() const { return nav->symmetric ? nav->costs : nav->rev_costs; }
+
+	//dijkstra (or A* if to >= 0) that never leaves cluster c, or goes
+	//anywhere if c < 0. reverse walks links backwards. stops early at to.
+	void localSearch(int src, int to, int c, bool reverse, SearchContext& ctx) const
+	{
+		const std::vector<int>& off = reverse ? inOffsets() : nav->offsets;
+		const std::vector<int>& nb = reverse ? inNbrs() : nav->nbrs;
+		const std::vector<float>& cst = reverse ? inCosts() : nav->costs;
+
+		auto h = [&](int v) { return to < 0 ? 0 : (nav->pos[v] - nav->pos[to]).mag(); };
+
+		ctx.begin(nav->size());
+		ctx.visit(src, 0, -1);
+		ctx.open.push(src, h(src));
+		while (!ctx.open.empty())
+		{
+			int curr = ctx.open.pop();
+			ctx.close(curr);
+			ctx.stats.expanded++;
+			if (curr == to) return;
+
+			for (int e = off[curr]; e < off[curr + 1]; e++)
+			{
+				int nbr = nb[e];
+				if ((c >= 0 && cluster[nbr] != c) || blocked[nbr] || ctx.isClosed(nbr)) continue;
+				float g = ctx.g_cost[curr] + cst[e];
+				bool in_open = ctx.isSeen(nbr);
+				if (!in_open || g < ctx.g_cost[nbr])
+				{
+					ctx.visit(nbr, g, curr);
+					if (in_open) ctx.open.decrease(nbr, g + h(nbr));
+					else ctx.open.push(nbr, g + h(nbr));
+				}
+			}
+		}
+	}
+
+	//the node of part p behind the cheapest link of a, out links first
+	int partner(int a, int p) const
+	{
+		int best = -1;
+		float best_cost = INFINITY;
+		for (int e = nav->offsets[a]; e < nav->offsets[a + 1]; e++)
+		{
+			int b = nav->nbrs[e];
+			if (part[b] == p && nav->costs[e] < best_cost) best = b, best_cost = nav->costs[e];
+		}
+		if (best >= 0) return best;
+		for (int e = inOffsets()[a]; e < inOffsets()[a + 1]; e++)
+		{
+			int b = inNbrs()[e];
+			if (part[b] == p && inCosts()[e] < best_cost) best = b, best_cost = inCosts()[e];
+		}
+		return best;
+	}
+
+	//floods c's unblocked nodes into parts through links inside c,
+	//either way. each part is named by its first member.
+	void labelParts(int c)
+	{
+		for (const auto& m : members[c]) part[m] = -1;
+		std::vector<int> stack;
+		for (const auto& m : members[c])
+		{
+			if (blocked[m] || part[m] >= 0) continue;
+			part[m] = m;
+			stack.assign(1, m);
+			while (stack.size())
+			{
+				const int v = stack.back();
+				stack.pop_back();
+				auto spread = [&](const std::vector<int>& off, const std::vector<int>& nb) {
+					for (int e = off[v]; e < off[v + 1]; e++)
+					{
+						const int u = nb[e];
+						if (cluster[u] != c || blocked[u] || part[u] >= 0) continue;
+						part[u] = m;
+						stack.push_back(u);
+					}
+				};
+				spread(nav->offsets, nav->nbrs);
+				spread(inOffsets(), inNbrs());
+			}
+		}
+	}
+
+	//picks entrance pairs on every border between c and a higher cluster.
+	//a run is a connected set of c's nodes that all link into the same
+	//part of a cluster d, so every node on either side of a crossing can
+	//get to the pair without leaving its cluster. short runs cross at the
+	//node nearest their middle, runs of 6 or more at both ends, like the
+	//original HPA* paper.
+	//appends every cluster whose entrances may have changed to changed.
+	void pickBorders(int c, std::vector<int>& changed)
+	{
+		for (const auto& ab : borders[c])
+		{
+			picks[ab.first]--, picks[ab.second]--;
+			changed.push_back(cluster[ab.second]);
+		}
+		borders[c].clear();
+		changed.push_back(c);
+
+		//{p, a} for each node a of c linking into part p of a higher cluster
+		std::vector<std::pair<int, int>> links;
+		auto collect = [&](int a, const std::vector<int>& off, const std::vector<int>& nb) {
+			for (int e = off[a]; e < off[a + 1]; e++)
+			{
+				int b = nb[e];
+				if (!blocked[b] && cluster[b] > c) links.push_back({ part[b], a });
+			}
+		};
+		for (const auto& a : members[c])
+		{
+			if (blocked[a]) continue;
+			collect(a, nav->offsets, nav->nbrs);
+			collect(a, inOffsets(), inNbrs());
+		}
+		std::sort(links.begin(), links.end());
+		links.erase(std::unique(links.begin(), links.end()), links.end());
+
+		std::vector<int> nodes;
+		for (int i = 0; i < (int)links.size();)
+		{
+			const int p = links[i].first, d = cluster[p];
+			run_stamp++;
+			int end = i;
+			for (; end < (int)links.size() && links[end].first == p; end++) run[links[end].second] = run_stamp;
+
+			for (; i < end; i++)
+			{
+				if (run[links[i].second] != run_stamp) continue;
+
+				//flood the run through links inside c, unmarking as it goes
+				nodes.assign(1, links[i].second);
+				run[links[i].second] = 0;
+				cmn::vf3d mid;
+				for (int k = 0; k < (int)nodes.size(); k++)
+				{
+					const int v = nodes[k];
+					mid += nav->pos[v];
+					auto spread = [&](const std::vector<int>& off, const std::vector<int>& nb) {
+						for (int e = off[v]; e < off[v + 1]; e++)
+						{
+							if (run[nb[e]] != run_stamp) continue;
+							run[nb[e]] = 0;
+							nodes.push_back(nb[e]);
+						}
+					};
+					spread(nav->offsets, nav->nbrs);
+					spread(inOffsets(), inNbrs());
+				}
+				mid /= float(nodes.size());
+
+				auto extreme = [&](const cmn::vf3d& from, bool nearest) {
+					int best = nodes.front();
+					for (const auto& v : nodes)
+					{
+						float dv = (nav->pos[v] - from).mag(), db = (nav->pos[best] - from).mag();
+						if (nearest ? dv < db : dv > db) best = v;
+					}
+					return best;
+				};
+				int ends[2]{ extreme(mid, true), -1 };
+				if (nodes.size() >= 6)
+				{
+					ends[0] = extreme(mid, false);
+					ends[1] = extreme(nav->pos[ends[0]], false);
+				}
+
+				for (const auto& a : ends)
+				{
+					if (a < 0) continue;
+					int b = partner(a, p);
+					if (b < 0) continue;
+					borders[c].push_back({ a, b });
+					picks[a]++, picks[b]++;
+					changed.push_back(d);
+				}
+			}
+		}
+	}
+
+	//re-reads c's entrances, then redoes its tables and trees if they
+	//changed or force is set
+	void rebuildCluster(int c, SearchContext& ctx, bool force)
+	{
+		std::vector<int> found;
+		for (const auto& m : members[c])
+		{
+			if (!blocked[m] && picks[m] > 0) found.push_back(m);
+		}
+		if (!force && found == entrances[c]) return;
+
+		for (const auto& e : entrances[c]) slot[e] = -1;
+		entrances[c] = found;
+		for (int a = 0; a < (int)found.size(); a++) slot[found[a]] = a;
+
+		const int k = found.size(), m = members[c].size();
+		tables[c].assign(k * k, INFINITY);
+		trees[c].assign(k * m, -1);
+		for (int a = 0; a < k; a++)
+		{
+			localSearch(found[a], -1, c, false, ctx);
+			for (int b = 0; b < k; b++) tables[c][a * k + b] = ctx.g(found[b]);
+			for (int j = 0; j < m; j++)
+			{
+				if (ctx.isSeen(members[c][j])) trees[c][a * m + j] = ctx.parent[members[c][j]];
+			}
+		}
+	}
+
+	//walks parent links from b back to the root, appends root -> b without the root.
+	//parent_of(v) gives v's parent in a tree over one cluster.
+	template<typename F>
+	static void appendBranch(int b, F parent_of, std::vector<int>& path)
+	{
+		const size_t start = path.size();
+		for (int v = b; parent_of(v) != -1; v = parent_of(v)) path.push_back(v);
+		std::reverse(path.begin() + start, path.end());
+	}
+
+public:
+	int numClusters() const { return members.size(); }
+
+	int numEntrances() const
+	{
+		int num = 0;
+		for (const auto& e : entrances) num += e.size();
+		return num;
+	}
+
+	size_t memoryUsage() const
+	{
+		size_t total = (cluster.capacity() + part.capacity() + slot.capacity() + member_slot.capacity() + picks.capacity() + run.capacity()) * sizeof(int) +
+			blocked.capacity() / 8;
+		for (const auto& m : members) total += m.capacity() * sizeof(int);
+		for (const auto& e : entrances) total += e.capacity() * sizeof(int);
+		for (const auto& t : tables) total += t.capacity() * sizeof(float);
+		for (const auto& t : trees) total += t.capacity() * sizeof(int);
+		for (const auto& b : borders) total += b.capacity() * sizeof(std::pair<int, int>);
+		return total;
+	}
+
+	//cluster_size is the side length of a cluster in world units.
+	//keeps a pointer to nav, which must outlive this and stay unchanged.
+	static HierarchicalGraph build(const NavGraph& nav, float cluster_size)
+	{
+		HierarchicalGraph h;
+		h.nav = &nav;
+		h.cell = cluster_size > 0 ? cluster_size : 1;
+
+		const int n = nav.size();
+		float max_x = 0, max_z = 0;
+		for (int i = 0; i < n; i++)
+		{
+			const auto& p = nav.pos[i];
+			if (i == 0 || p.x < h.min_x) h.min_x = p.x;
+			if (i == 0 || p.z < h.min_z) h.min_z = p.z;
+			if (i == 0 || p.x > max_x) max_x = p.x;
+			if (i == 0 || p.z > max_z) max_z = p.z;
+		}
+		h.cols = 1 + int((max_x - h.min_x) / h.cell);
+		h.rows = 1 + int((max_z - h.min_z) / h.cell);
+
+		h.cluster.resize(n);
+		h.part.assign(n, -1);
+		h.member_slot.resize(n);
+		h.blocked.assign(n, false);
+		h.slot.assign(n, -1);
+		h.picks.assign(n, 0);
+		h.run.assign(n, 0);
+		h.members.resize(h.cols * h.rows);
+		h.entrances.resize(h.cols * h.rows);
+		h.tables.resize(h.cols * h.rows);
+		h.trees.resize(h.cols * h.rows);
+		h.borders.resize(h.cols * h.rows);
+		for (int i = 0; i < n; i++)
+		{
+			int cx = std::min(h.cols - 1, int((nav.pos[i].x - h.min_x) / h.cell));
+			int cz = std::min(h.rows - 1, int((nav.pos[i].z - h.min_z) / h.cell));
+			h.cluster[i] = cx + h.cols * cz;
+			h.member_slot[i] = h.members[h.cluster[i]].size();
+			h.members[h.cluster[i]].push_back(i);
+		}
+
+		for (int c = 0; c < h.numClusters(); c++) h.labelParts(c);
+		std::vector<int> changed;
+		for (int c = 0; c < h.numClusters(); c++) h.pickBorders(c, changed);
+		SearchContext ctx;
+		for (int c = 0; c < h.numClusters(); c++) h.rebuildCluster(c, ctx, true);
+
+		return h;
+	}
+
+	//take a node out of the hierarchy (e.g. an obstacle landed on it).
+	//its cluster may split into more parts, so that cluster and every lower
+	//one linking into it pick their borders again, then its own cluster and
+	//whichever others ended up with different entrances are rebuilt.
+	void removeNode(int i)
+	{
+		if (i < 0 || i >= (int)blocked.size() || blocked[i]) return;
+		blocked[i] = true;
+		const int ci = cluster[i];
+		labelParts(ci);
+
+		std::vector<int> touched{ ci };
+		for (const auto& m : members[ci])
+		{
+			for (int e = nav->offsets[m]; e < nav->offsets[m + 1]; e++)
+			{
+				if (cluster[nav->nbrs[e]] < ci) touched.push_back(cluster[nav->nbrs[e]]);
+			}
+			for (int e = inOffsets()[m]; e < inOffsets()[m + 1]; e++)
+			{
+				if (cluster[inNbrs()[e]] < ci) touched.push_back(cluster[inNbrs()[e]]);
+			}
+		}
+		std::sort(touched.begin(), touched.end());
+		touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+		std::vector<int> changed;
+		for (const auto& c : touched) pickBorders(c, changed);
+		std::sort(changed.begin(), changed.end());
+		changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+		SearchContext ctx;
+		for (const auto& c : changed) rebuildCluster(c, ctx, c == ci);
+	}
+
+	bool isBlocked(int i) const { return blocked[i]; }
+
+	[[nodiscard]] std::vector<int> route(int from, int to, SearchContext& ctx) const
+	{
+		ctx.begin(nav ? nav->size() : 0);
+		if (!nav || from < 0 || to < 0 || from >= nav->size() || to >= nav->size() || from == to) return {};
+		if (blocked[from] || blocked[to]) return {};
+
+		SearchContext& local = ctx.reverse();
+		RouteStats local_stats;
+		const int cs = cluster[from], ct = cluster[to];
+
+		//start -> its cluster's entrances, and maybe straight to the goal.
+		//its tree is kept for the first stretch of the path.
+		float best = INFINITY;
+		localSearch(from, -1, cs, false, local);
+		local_stats.expanded += local.stats.expanded;
+		if (cs == ct) best = local.g(to);
+		std::vector<float> g_start(entrances[cs].size());
+		for (int a = 0; a < (int)g_start.size(); a++) g_start[a] = local.g(entrances[cs][a]);
+		std::vector<int> start_tree(members[cs].size(), -1);
+		for (int j = 0; j < (int)start_tree.size(); j++)
+		{
+			if (local.isSeen(members[cs][j])) start_tree[j] = local.parent[members[cs][j]];
+		}
+
+		//goal cluster's entrances -> goal, searched backwards, so in this
+		//tree each node's parent is the next step towards the goal
+		localSearch(to, -1, ct, true, local);
+		local_stats.expanded += local.stats.expanded;
+		std::vector<float> g_goal(entrances[ct].size());
+		for (int b = 0; b < (int)g_goal.size(); b++) g_goal[b] = local.g(entrances[ct][b]);
+
+		//abstract A* over entrances, seeded from the start cluster
+		ctx.begin(nav->size());
+		const cmn::vf3d& goal = nav->pos[to];
+		for (int a = 0; a < (int)g_start.size(); a++)
+		{
+			if (std::isinf(g_start[a])) continue;
+			int e = entrances[cs][a];
+			ctx.visit(e, g_start[a], -1);
+			ctx.open.push(e, g_start[a] + (nav->pos[e] - goal).mag());
+		}
+
+		int last = -1;
+		while (!ctx.open.empty() && ctx.open.topKey() < best)
+		{
+			int curr = ctx.open.pop();
+			ctx.close(curr);
+			ctx.stats.expanded++;
+
+			//leaving through the goal cluster
+			if (cluster[curr] == ct)
+			{
+				float total = ctx.g_cost[curr] + g_goal[slot[curr]];
+				if (total < best) best = total, last = curr;
+			}
+
+			auto relax = [&](int nbr, float g) {
+				if (ctx.isClosed(nbr)) return;
+				bool in_open = ctx.isSeen(nbr);
+				if (!in_open || g < ctx.g_cost[nbr])
+				{
+					ctx.visit(nbr, g, curr);
+					float f = g + (nav->pos[nbr] - goal).mag();
+					if (in_open) ctx.open.decrease(nbr, f);
+					else ctx.open.push(nbr, f);
+				}
+			};
+
+			//across the cluster
+			const int c = cluster[curr], k = entrances[c].size();
+			const float* row = &tables[c][slot[curr] * k];
+			for (int b = 0; b < k; b++)
+			{
+				if (!std::isinf(row[b]) && b != slot[curr]) relax(entrances[c][b], ctx.g_cost[curr] + row[b]);
+			}
+
+			//out of the cluster, into another entrance
+			for (int e = nav->offsets[curr]; e < nav->offsets[curr + 1]; e++)
+			{
+				int nbr = nav->nbrs[e];
+				if (blocked[nbr] || cluster[nbr] == c || slot[nbr] < 0) continue;
+				relax(nbr, ctx.g_cost[curr] + nav->costs[e]);
+			}
+		}
+
+		//one way links can hide a route from the runs and parts, see the top
+		if (std::isinf(best) && !nav->symmetric && nav->connected(from, to))
+		{
+			localSearch(from, to, -1, false, local);
+			ctx.stats.expanded += local_stats.expanded + local.stats.expanded;
+			if (local.isClosed(to)) return local.tracePath(to);
+			return {};
+		}
+
+		auto start_parent = [&](int v) { return start_tree[member_slot[v]]; };
+		std::vector<int> path{ from };
+		if (std::isinf(best)) path.clear();
+		//stayed inside one cluster
+		else if (last < 0) appendBranch(to, start_parent, path);
+		else
+		{
+			std::vector<int> hops = ctx.tracePath(last);
+			appendBranch(hops.front(), start_parent, path);
+			for (int i = 1; i < (int)hops.size(); i++)
+			{
+				int a = hops[i - 1], b = hops[i];
+				const int c = cluster[a];
+				if (c != cluster[b]) path.push_back(b);
+				else
+				{
+					const int* tree = &trees[c][slot[a] * members[c].size()];
+					appendBranch(b, [&](int v) { return tree[member_slot[v]]; }, path);
+				}
+			}
+			for (int v = local.parent[last]; v != -1; v = local.parent[v]) path.push_back(v);
+		}
+
+		ctx.stats.expanded += local_stats.expanded;
+		return path;
+	}
+
+	[[nodiscard]] std::vector<Node*> route(Node* from, Node* to, RouteStats* stats = nullptr) const
+	{
+		SearchContext& ctx = SearchContext::local();
+		std::vector<Node*> path;
+		for (const auto& i : route(nav ? nav->indexOf(from) : -1, nav ? nav->indexOf(to) : -1, ctx))
+		{
+			path.push_back(nav->nodes[i]);
+		}
+		if (stats) *stats = ctx.stats;
+		return path;
+	}
+};
+#endif//HIERARCHICAL_GRAPH_CLASS_H
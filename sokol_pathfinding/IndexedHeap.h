@@ -0,0 +1,155 @@
+#pragma once
+#ifndef INDEXED_HEAP_CLASS_H
+#define INDEXED_HEAP_CLASS_H
+
+#include <vector>
+
+//binary min heap over dense ids [0, capacity)
+//keeps a slot per id so membership and decrease-key are O(1)/O(log n).
+//ties on key break by push order, so a heap pop matches a
+//"first lowest in insertion order" linear scan exactly.
+//the key type only needs < and !=, so searches can use compound keys.
+template<typename Key>
+class BasicIndexedHeap
+{
+	struct Entry
+	{
+		Key key;
+		unsigned seq;
+		int id;
+	};
+
+	std::vector<Entry> heap;
+	std::vector<int> slot;
+	unsigned next_seq = 0;
+
+	static bool less(const Entry& a, const Entry& b)
+	{
+		if (a.key != b.key) return a.key < b.key;
+		return a.seq < b.seq;
+	}
+
+	void place(int i, const Entry& e)
+	{
+		heap[i] = e;
+		slot[e.id] = i;
+	}
+
+	void siftUp(int i)
+	{
+		Entry e = heap[i];
+		while (i > 0)
+		{
+			int p = (i - 1) / 2;
+			if (!less(e, heap[p])) break;
+			place(i, heap[p]);
+			i = p;
+		}
+		place(i, e);
+	}
+
+	void siftDown(int i)
+	{
+		Entry e = heap[i];
+		int n = heap.size();
+		for (;;)
+		{
+			int c = 2 * i + 1;
+			if (c >= n) break;
+			if (c + 1 < n && less(heap[c + 1], heap[c])) c++;
+			if (!less(heap[c], e)) break;
+			place(i, heap[c]);
+			i = c;
+		}
+		place(i, e);
+	}
+
+public:
+	BasicIndexedHeap() {}
+
+	//grows the id range, never shrinks it.
+	void reserve(int capacity)
+	{
+		if (capacity > (int)slot.size()) slot.resize(capacity, -1);
+	}
+
+	//O(size), not O(capacity)
+	void clear()
+	{
+		for (const auto& e : heap) slot[e.id] = -1;
+		heap.clear();
+		next_seq = 0;
+	}
+
+	bool empty() const { return heap.empty(); }
+	int size() const { return heap.size(); }
+
+	bool contains(int id) const { return slot[id] >= 0; }
+
+	Key keyOf(int id) const { return heap[slot[id]].key; }
+
+	int top() const { return heap.front().id; }
+	Key topKey() const { return heap.front().key; }
+
+	void push(int id, Key key)
+	{
+		heap.push_back({ key, next_seq++, id });
+		slot[id] = heap.size() - 1;
+		siftUp(heap.size() - 1);
+	}
+
+	//keeps original push order for tie breaking.
+	void decrease(int id, Key key)
+	{
+		int i = slot[id];
+		heap[i].key = key;
+		siftUp(i);
+	}
+
+	//push, or move an existing entry in either direction.
+	void update(int id, Key key)
+	{
+		if (!contains(id))
+		{
+			push(id, key);
+			return;
+		}
+
+		int i = slot[id];
+		Key old = heap[i].key;
+		heap[i].key = key;
+		if (key < old) siftUp(i);
+		else siftDown(i);
+	}
+
+	int pop()
+	{
+		int id = heap.front().id;
+		slot[id] = -1;
+		Entry last = heap.back();
+		heap.pop_back();
+		if (heap.size())
+		{
+			heap[0] = last;
+			siftDown(0);
+		}
+		return id;
+	}
+
+	void remove(int id)
+	{
+		int i = slot[id];
+		slot[id] = -1;
+		Entry last = heap.back();
+		heap.pop_back();
+		if (i == (int)heap.size()) return;
+
+		heap[i] = last;
+		slot[last.id] = i;
+		if (i > 0 && less(last, heap[(i - 1) / 2])) siftUp(i);
+		else siftDown(i);
+	}
+};
+
+typedef BasicIndexedHeap<float> IndexedHeap;
+#endif//INDEXED_HEAP_CLASS_H
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef LANDMARKS_STRUCT_H
+#define LANDMARKS_STRUCT_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+//precomputed graph distances to/from a handful of landmark nodes (ALT).
+//by the triangle inequality, for any landmark L:
+//  d(v, t) >= d(L, t) - d(L, v)   and   d(v, t) >= d(v, L) - d(t, L)
+//the max over landmarks is an admissible, consistent A* heuristic
+//that knows about walls, unlike straight line distance.
+//built by NavGraph::makeLandmarks, only valid for that freeze.
+struct Landmarks
+{
+	std::vector<int> ids;
+
+	//node major, k floats per node, so one bound() reads two short runs.
+	//to_lm is left empty when the graph is symmetric (same as from_lm).
+	std::vector<float> from_lm, to_lm;
+
+	int num() const { return ids.size(); }
+
+	int numNodes() const { return ids.empty() ? 0 : from_lm.size() / ids.size(); }
+
+	size_t memoryUsage() const
+	{
+		return ids.capacity() * sizeof(int) + (from_lm.capacity() + to_lm.capacity()) * sizeof(float);
+	}
+
+	//lower bound on d(v, t), 0 if nothing is known
+	float bound(int v, int t) const
+	{
+		const int k = ids.size();
+		const float* fv = &from_lm[v * k];
+		const float* ft = &from_lm[t * k];
+		const float* tv = to_lm.empty() ? fv : &to_lm[v * k];
+		const float* tt = to_lm.empty() ? ft : &to_lm[t * k];
+
+		float best = 0;
+		for (int i = 0; i < k; i++)
+		{
+			//unreachable entries carry no information
+			if (!std::isinf(fv[i]) && !std::isinf(ft[i])) best = std::max(best, ft[i] - fv[i]);
+			if (!std::isinf(tv[i]) && !std::isinf(tt[i])) best = std::max(best, tv[i] - tt[i]);
+		}
+		return best;
+	}
+};
+#endif//LANDMARKS_STRUCT_H
@@ -0,0 +1,709 @@
+#pragma once
+#ifndef NAV_GRAPH_STRUCT_H
+#define NAV_GRAPH_STRUCT_H
+
+#include "math/v3d.h"
+#include "Node.h"
+#include "SearchContext.h"
+#include "Landmarks.h"
+#include "PathSmoothing.h"
+#include "EdgeCost.h"
+#include "Components.h"
+#include "NodeOrder.h"
+
+#include <climits>
+#include <cstdint>
+#include <list>
+#include <vector>
+#include <algorithm>
+
+enum RouteMode
+{
+	ROUTE_ASTAR,
+	ROUTE_BIDIRECTIONAL,
+	ROUTE_THETA,
+	ROUTE_FOCAL
+};
+
+//how a NavGraph::stepAStar call ended
+enum AStarStep
+{
+	ASTAR_FOUND,
+	ASTAR_NO_PATH,
+	ASTAR_PAUSED
+};
+
+//per query knobs, defaults give plain A*
+struct RouteOptions
+{
+	RouteMode mode = ROUTE_ASTAR;
+
+	//ALT heuristic, must come from the same freeze being searched
+	const Landmarks* landmarks = nullptr;
+
+	//geometry for line of sight checks (smoothing, Theta*)
+	const TriangleBVH* obstacles = nullptr;
+
+	//drop waypoints with a clear line of sight past them, needs obstacles
+	bool smooth = false;
+
+	//suboptimality for ROUTE_ASTAR (f = g + weight * h) and ROUTE_FOCAL.
+	//paths cost at most weight times the optimum, 1 is exact A*.
+	float weight = 1;
+};
+
+//node -> index for one freeze. Node::id gets renumbered by every later
+//freeze, possibly on another thread, so snapshots look nodes up here
+//and never read it. open addressing over a flat array at most half full.
+struct NodeIndex
+{
+	std::vector<std::pair<const Node*, int>> slots;
+
+	static size_t mix(const Node* n)
+	{
+		uint64_t h = uint64_t(reinterpret_cast<uintptr_t>(n));
+		h ^= h >> 31;
+		h *= 0xbf58476d1ce4e5b9ull;
+		h ^= h >> 29;
+		return h;
+	}
+
+	void build(const std::vector<Node*>& nodes)
+	{
+		size_t cap = 16;
+		while (cap < 2 * nodes.size()) cap *= 2;
+		slots.assign(cap, { nullptr, -1 });
+		for (int i = 0; i < (int)nodes.size(); i++)
+		{
+			size_t j = mix(nodes[i]) & (cap - 1);
+			while (slots[j].first) j = (j + 1) & (cap - 1);
+			slots[j] = { nodes[i], i };
+		}
+	}
+
+	//-1 if n isnt there
+	int find(const Node* n) const
+	{
+		if (!n || slots.empty()) return -1;
+		const size_t mask = slots.size() - 1;
+		for (size_t j = mix(n) & mask; slots[j].first; j = (j + 1) & mask)
+		{
+			if (slots[j].first == n) return slots[j].second;
+		}
+		return -1;
+	}
+
+	size_t memoryUsage() const { return slots.capacity() * sizeof(slots[0]); }
+};
+
+//frozen, index based copy of a Graph in compressed sparse row form.
+//node i's neighbors are nbrs[offsets[i]..offsets[i+1]),
+//with the matching edge lengths in costs.
+//build once after editing is done, then query as much as you want.
+struct NavGraph
+{
+	std::vector<cmn::vf3d> pos;
+	std::vector<int> offsets{ 0 };
+	std::vector<int> nbrs;
+	std::vector<float> costs;
+
+	//incoming edges, same layout. left empty when every link has
+	//a matching link back, then the outgoing arrays double as incoming.
+	std::vector<int> rev_offsets, rev_nbrs;
+	std::vector<float> rev_costs;
+	bool symmetric = true;
+
+	//index -> node it was built from, and back
+	std::vector<Node*> nodes;
+	NodeIndex node_index;
+
+	//label per node, links taken as two way (see Components.h).
+	//empty means unknown, then everything counts as connected.
+	std::vector<int> component;
+	int num_components = 0;
+
+	int size() const { return pos.size(); }
+	int numEdges() const { return nbrs.size(); }
+
+	int degree(int i) const { return offsets[i + 1] - offsets[i]; }
+
+	//through node_index, so it stays right for an old snapshot
+	//after the graph has been frozen again
+	int indexOf(const Node* n) const { return node_index.find(n); }
+
+	size_t memoryUsage() const
+	{
+		return pos.capacity() * sizeof(cmn::vf3d) +
+			offsets.capacity() * sizeof(int) +
+			nbrs.capacity() * sizeof(int) +
+			costs.capacity() * sizeof(float) +
+			rev_offsets.capacity() * sizeof(int) +
+			rev_nbrs.capacity() * sizeof(int) +
+			rev_costs.capacity() * sizeof(float) +
+			nodes.capacity() * sizeof(Node*) +
+			node_index.memoryUsage() +
+			component.capacity() * sizeof(int);
+	}
+
+	//numbers nodes in list order, or as order says (see NodeOrder.h), keeps link order.
+	//edge costs come from cost (see EdgeCost.h), evaluated once per link here.
+	template<typename CostFn = DistanceCost>
+	static NavGraph makeFromNodes(const std::list<Node*>& src, const CostFn& cost = {}, NodeOrder order = ORDER_LIST)
+	{
+		NavGraph g;
+		g.nodes.assign(src.begin(), src.end());
+		orderNodes(g.nodes, order);
+
+		g.pos.reserve(g.nodes.size());
+		g.offsets.reserve(g.nodes.size() + 1);
+		for (int i = 0; i < (int)g.nodes.size(); i++)
+		{
+			g.nodes[i]->id = i;
+			g.pos.push_back(g.nodes[i]->pos);
+		}
+
+		for (const auto& n : g.nodes)
+		{
+			for (const auto& l : n->links)
+			{
+				//dangling link?
+				if (l->id < 0 || l->id >= g.size() || g.nodes[l->id] != l) continue;
+
+				//impassable?
+				float c = cost(n, l);
+				if (!(c < INFINITY)) continue;
+
+				g.nbrs.push_back(l->id);
+				g.costs.push_back(std::max(c, (l->pos - n->pos).mag()));
+			}
+			g.offsets.push_back(g.nbrs.size());
+		}
+
+		g.node_index.build(g.nodes);
+		g.buildReverse();
+		g.buildComponents();
+
+		return g;
+	}
+
+	bool hasEdge(int a, int b) const
+	{
+		return !std::isinf(edgeCost(a, b));
+	}
+
+	//INFINITY if there is no a -> b edge
+	float edgeCost(int a, int b) const
+	{
+		for (int e = offsets[a]; e < offsets[a + 1]; e++)
+		{
+			if (nbrs[e] == b) return costs[e];
+		}
+		return INFINITY;
+	}
+
+	//only materializes incoming edges if some link is one way,
+	//or costs more one way than the other.
+	void buildReverse()
+	{
+		rev_offsets.clear(), rev_nbrs.clear(), rev_costs.clear();
+
+		symmetric = true;
+		for (int i = 0; i < size() && symmetric; i++)
+		{
+			for (int e = offsets[i]; e < offsets[i + 1]; e++)
+			{
+				if (edgeCost(nbrs[e], i) != costs[e])
+				{
+					symmetric = false;
+					break;
+				}
+			}
+		}
+		if (symmetric) return;
+
+		//counting sort edges by target
+		rev_offsets.assign(size() + 1, 0);
+		for (const auto& n : nbrs) rev_offsets[n + 1]++;
+		for (int i = 0; i < size(); i++) rev_offsets[i + 1] += rev_offsets[i];
+
+		std::vector<int> fill(rev_offsets.begin(), rev_offsets.end() - 1);
+		rev_nbrs.resize(nbrs.size());
+		rev_costs.resize(nbrs.size());
+		for (int i = 0; i < size(); i++)
+		{
+			for (int e = offsets[i]; e < offsets[i + 1]; e++)
+			{
+				int slot = fill[nbrs[e]]++;
+				rev_nbrs[slot] = i;
+				rev_costs[slot] = costs[e];
+			}
+		}
+	}
+
+	//one pass of union-find over the edges, cheap next to the rest of a freeze
+	void buildComponents()
+	{
+		DisjointSets sets;
+		sets.reset(size());
+		for (int i = 0; i < size(); i++)
+		{
+			for (int e = offsets[i]; e < offsets[i + 1]; e++) sets.unite(i, nbrs[e]);
+		}
+		component = sets.labels();
+		num_components = sets.numSets();
+	}
+
+	//false means no path from a to b exists, O(1).
+	//true is exact for two way graphs, with one way links it only
+	//says a and b are not cut off from each other entirely.
+	bool connected(int a, int b) const
+	{
+		if (a < 0 || b < 0 || a >= size() || b >= size()) return false;
+		return component.empty() || component[a] == component[b];
+	}
+
+	//admissible lower bound on d(a, b): straight line, tightened by landmarks if given
+	float estimate(int a, int b, const RouteOptions& opts) const
+	{
+		float h = (pos[a] - pos[b]).mag();
+		if (opts.landmarks) h = std::max(h, opts.landmarks->bound(a, b));
+		return h;
+	}
+
+	//one to all dijkstra from src, results in ctx.g(i).
+	//reverse follows links backwards, giving distances to src instead.
+	void dijkstra(int src, SearchContext& ctx, bool reverse = false) const
+	{
+		dijkstra(src, ctx, reverse, [](int) { return true; });
+	}
+
+	//same, calling settled(i) once i's distance is final.
+	//returning false from it stops the search there.
+	template<typename F>
+	void dijkstra(int src, SearchContext& ctx, bool reverse, F settled) const
+	{
+		ctx.begin(size());
+		if (src < 0 || src >= size()) return;
+
+		const bool fwd = !reverse || symmetric;
+		const std::vector<int>& off = fwd ? offsets : rev_offsets;
+		const std::vector<int>& nb = fwd ? nbrs : rev_nbrs;
+		const std::vector<float>& cst = fwd ? costs : rev_costs;
+
+		ctx.visit(src, 0, -1);
+		ctx.open.push(src, 0);
+		while (!ctx.open.empty())
+		{
+			int curr = ctx.open.pop();
+			ctx.close(curr);
+			ctx.stats.expanded++;
+			if (!settled(curr)) return;
+
+			for (int e = off[curr]; e < off[curr + 1]; e++)
+			{
+				int nbr = nb[e];
+				if (ctx.isClosed(nbr)) continue;
+				float g = ctx.g_cost[curr] + cst[e];
+				bool in_open = ctx.isSeen(nbr);
+				if (!in_open || g < ctx.g_cost[nbr])
+				{
+					ctx.visit(nbr, g, curr);
+					if (in_open) ctx.open.decrease(nbr, g);
+					else ctx.open.push(nbr, g);
+				}
+			}
+		}
+	}
+
+	//picks k landmarks by farthest-first: each new one is the node
+	//furthest (by graph distance) from all picked so far, which spreads
+	//them around the edges of the map where they give the best bounds.
+	Landmarks makeLandmarks(int k, int seed_node = 0) const
+	{
+		Landmarks lm;
+		if (size() == 0 || k <= 0) return lm;
+		k = std::min(k, size());
+
+		SearchContext ctx;
+		std::vector<float> nearest(size(), INFINITY);
+
+		//farthest reachable node from whatever was last searched
+		auto farthest = [&](const std::vector<float>& d) {
+			int record = -1;
+			for (int i = 0; i < size(); i++)
+			{
+				if (std::isinf(d[i])) continue;
+				if (record < 0 || d[i] > d[record]) record = i;
+			}
+			return record;
+		};
+
+		//first pick is the far end of the seed's component
+		dijkstra(std::min(std::max(0, seed_node), size() - 1), ctx);
+		std::vector<float> d(size());
+		for (int i = 0; i < size(); i++) d[i] = ctx.g(i);
+		int next = farthest(d);
+
+		while ((int)lm.ids.size() < k && next >= 0)
+		{
+			lm.ids.push_back(next);
+			dijkstra(next, ctx);
+			for (int i = 0; i < size(); i++) nearest[i] = std::min(nearest[i], ctx.g(i));
+
+			next = farthest(nearest);
+			//everything left is a landmark already
+			if (next >= 0 && nearest[next] <= 0) break;
+		}
+
+		k = lm.ids.size();
+		lm.from_lm.assign(size() * k, INFINITY);
+		if (!symmetric) lm.to_lm.assign(size() * k, INFINITY);
+		for (int j = 0; j < k; j++)
+		{
+			dijkstra(lm.ids[j], ctx);
+			for (int i = 0; i < size(); i++) lm.from_lm[i * k + j] = ctx.g(i);
+
+			if (symmetric) continue;
+			dijkstra(lm.ids[j], ctx, true);
+			for (int i = 0; i < size(); i++) lm.to_lm[i * k + j] = ctx.g(i);
+		}
+
+		return lm;
+	}
+
+	//seeds ctx with from for stepAStar toward to. ctx must be begun on this graph.
+	void beginAStar(int from, int to, SearchContext& ctx, const RouteOptions& opts = {}) const
+	{
+		ctx.visit(from, 0, -1);
+		ctx.open.push(from, std::max(1.f, opts.weight) * estimate(from, to, opts));
+	}
+
+	//expands at most budget nodes of the A* search in ctx, calling
+	//expanded(curr) after each node other than the goal. returning false
+	//from it pauses there. ASTAR_PAUSED searches carry on with the next
+	//call, for as long as ctx and the graph are left alone.
+	template<typename F>
+	AStarStep stepAStar(int to, SearchContext& ctx, const RouteOptions& opts, int budget, F expanded) const
+	{
+		const float w = std::max(1.f, opts.weight);
+		for (int i = 0; i < budget; i++)
+		{
+			if (ctx.open.empty()) return ASTAR_NO_PATH;
+
+			//lowest f_cost
+			int curr = ctx.open.pop();
+			ctx.close(curr);
+			ctx.stats.expanded++;
+
+			if (curr == to) return ASTAR_FOUND;
+
+			for (int e = offsets[curr]; e < offsets[curr + 1]; e++)
+			{
+				int nbr = nbrs[e];
+				if (ctx.isClosed(nbr)) continue;
+
+				//new path shorter OR neighbor NOT in OPEN
+				float new_g_cost = ctx.g_cost[curr] + costs[e];
+				bool in_open = ctx.isSeen(nbr);
+				if (!in_open || new_g_cost < ctx.g_cost[nbr])
+				{
+					ctx.visit(nbr, new_g_cost, curr);
+					float f_cost = new_g_cost + w * estimate(nbr, to, opts);
+					if (in_open) ctx.open.decrease(nbr, f_cost);
+					else ctx.open.push(nbr, f_cost);
+				}
+			}
+
+			if (!expanded(curr)) return ASTAR_PAUSED;
+		}
+
+		return ASTAR_PAUSED;
+	}
+
+	//A* with straight line (or landmark) heuristic. returns indexes from->to, or empty.
+	//all search state lives in ctx, the graph is only read.
+	//opts.weight > 1 inflates the heuristic (weighted A*): fewer expansions,
+	//paths within weight times the optimum even without reopening nodes.
+	[[nodiscard]] std::vector<int> routeAStar(int from, int to, SearchContext& ctx, const RouteOptions& opts = {}) const
+	{
+		ctx.begin(size());
+		if (from < 0 || to < 0 || from >= size() || to >= size() || from == to) return {};
+
+		beginAStar(from, to, ctx, opts);
+		if (stepAStar(to, ctx, opts, INT_MAX, [](int) { return true; }) != ASTAR_FOUND) return {};
+		return ctx.tracePath(to);
+	}
+
+	//focal search (A*eps): of the open nodes with f <= weight * lowest f,
+	//expand the one that looks closest to the goal. same bound as weighted
+	//A*, but the search dives at the goal only while it has slack to spend.
+	//the bound needs closed nodes reached more cheaply later to count again.
+	//reopening them right away thrashes, so like ARA* they wait in an
+	//inconsistent list that still takes part in the lowest f, and are
+	//only reopened once they hold the bound back. the lowest f never
+	//drops, so nodes only move into the focal list, never back out.
+	[[nodiscard]] std::vector<int> routeFocal(int from, int to, SearchContext& ctx, const RouteOptions& opts = {}) const
+	{
+		const float w = std::max(1.f, opts.weight);
+		ctx.begin(size());
+
+		//focal list by estimate. every open node, the open nodes the bound
+		//hasnt reached yet, and the inconsistent closed nodes, all by f
+		IndexedHeap& focal = ctx.open;
+		IndexedHeap& by_f = ctx.open_f;
+		IndexedHeap& waiting = ctx.waiting;
+		IndexedHeap& incons = ctx.incons;
+		for (auto h : { &by_f, &waiting, &incons })
+		{
+			h->reserve(size());
+			h->clear();
+		}
+		if (from < 0 || to < 0 || from >= size() || to >= size() || from == to) return {};
+
+		ctx.visit(from, 0, -1);
+		by_f.push(from, estimate(from, to, opts));
+		focal.push(from, estimate(from, to, opts));
+
+		while (!by_f.empty() || !incons.empty())
+		{
+			float f_min = INFINITY;
+			if (!by_f.empty()) f_min = by_f.topKey();
+			if (!incons.empty()) f_min = std::min(f_min, incons.topKey());
+			const float bound = w * f_min;
+
+			while (!waiting.empty() && waiting.topKey() <= bound)
+			{
+				int v = waiting.pop();
+				focal.push(v, estimate(v, to, opts));
+			}
+
+			//nothing open is in reach, the lowest f is a closed node
+			if (focal.empty())
+			{
+				float f_cost = incons.topKey();
+				int v = incons.pop();
+				ctx.reopen(v);
+				by_f.push(v, f_cost);
+				focal.push(v, estimate(v, to, opts));
+				continue;
+			}
+
+			int curr = focal.pop();
+			by_f.remove(curr);
+			ctx.close(curr);
+			ctx.stats.expanded++;
+
+			if (curr == to) return ctx.tracePath(to);
+
+			for (int e = offsets[curr]; e < offsets[curr + 1]; e++)
+			{
+				int nbr = nbrs[e];
+				float new_g_cost = ctx.g_cost[curr] + costs[e];
+				if (ctx.isSeen(nbr) && new_g_cost >= ctx.g_cost[nbr]) continue;
+
+				ctx.visit(nbr, new_g_cost, curr);
+				float h = estimate(nbr, to, opts);
+				float f_cost = new_g_cost + h;
+				if (ctx.isClosed(nbr))
+				{
+					incons.update(nbr, f_cost);
+					continue;
+				}
+
+				by_f.update(nbr, f_cost);
+
+				//focal is keyed on h alone, nothing to update
+				if (focal.contains(nbr)) continue;
+				if (f_cost <= bound)
+				{
+					if (waiting.contains(nbr)) waiting.remove(nbr);
+					focal.push(nbr, h);
+				}
+				else waiting.update(nbr, f_cost);
+			}
+		}
+
+		return {};
+	}
+
+	//Theta*: A* where a neighbor can take curr's parent as its own parent
+	//whenever the two see each other past opts.obstacles, so paths cut
+	//across at any angle instead of following links. shortcuts cost their
+	//straight line length. consecutive path nodes need not be linked.
+	//landmark bounds are for link paths, so only straight line is used.
+	//without obstacles there is nothing to check against, so this is A*.
+	[[nodiscard]] std::vector<int> routeTheta(int from, int to, SearchContext& ctx, const RouteOptions& opts = {}) const
+	{
+		if (!opts.obstacles) return routeAStar(from, to, ctx, opts);
+
+		ctx.begin(size());
+		if (from < 0 || to < 0 || from >= size() || to >= size() || from == to) return {};
+
+		const TriangleBVH& obstacles = *opts.obstacles;
+		auto h = [&](int v) { return (pos[v] - pos[to]).mag(); };
+
+		ctx.visit(from, 0, -1);
+		ctx.open.push(from, h(from));
+
+		while (!ctx.open.empty())
+		{
+			int curr = ctx.open.pop();
+			ctx.close(curr);
+			ctx.stats.expanded++;
+
+			if (curr == to) return ctx.tracePath(to);
+
+			const int grand = ctx.parent[curr];
+			for (int e = offsets[curr]; e < offsets[curr + 1]; e++)
+			{
+				int nbr = nbrs[e];
+				if (ctx.isClosed(nbr)) continue;
+
+				//path 2: straight from the grandparent if nothing is in the way
+				int par = curr;
+				float new_g_cost = ctx.g_cost[curr] + costs[e];
+				if (grand >= 0)
+				{
+					ctx.stats.los_checks++;
+					if (!obstacles.segmentBlocked(pos[grand], pos[nbr]))
+					{
+						par = grand;
+						new_g_cost = ctx.g_cost[grand] + (pos[nbr] - pos[grand]).mag();
+					}
+				}
+
+				bool in_open = ctx.isSeen(nbr);
+				if (!in_open || new_g_cost < ctx.g_cost[nbr])
+				{
+					ctx.visit(nbr, new_g_cost, par);
+					float f_cost = new_g_cost + h(nbr);
+					if (in_open) ctx.open.decrease(nbr, f_cost);
+					else ctx.open.push(nbr, f_cost);
+				}
+			}
+		}
+
+		return {};
+	}
+
+	//A* from both ends with the symmetric "average" potential
+	//p(v) = (h(v, to) - h(from, v)) / 2, which keeps both sides consistent,
+	//so settled nodes stay settled and we can stop as soon as
+	//top forward key + top backward key >= best meeting cost.
+	[[nodiscard]] std::vector<int> routeBidirectional(int from, int to, SearchContext& ctx, const RouteOptions& opts = {}) const
+	{
+		SearchContext& bwd = ctx.reverse();
+		ctx.begin(size());
+		bwd.begin(size());
+		if (from < 0 || to < 0 || from >= size() || to >= size() || from == to) return {};
+
+		const std::vector<int>& in_offsets = symmetric ? offsets : rev_offsets;
+		const std::vector<int>& in_nbrs = symmetric ? nbrs : rev_nbrs;
+		const std::vector<float>& in_costs = symmetric ? costs : rev_costs;
+
+		auto potential = [&](int v) {
+			return .5f * (estimate(v, to, opts) - estimate(from, v, opts));
+		};
+
+		ctx.visit(from, 0, -1);
+		ctx.open.push(from, potential(from));
+		bwd.visit(to, 0, -1);
+		bwd.open.push(to, -potential(to));
+
+		float best = INFINITY;
+		int meet = -1;
+
+		//one settle step on one side, dir = +1 forward, -1 backward
+		auto step = [&](SearchContext& me, const SearchContext& other,
+			const std::vector<int>& off, const std::vector<int>& nb, const std::vector<float>& cst, float dir) {
+			int curr = me.open.pop();
+			me.close(curr);
+			ctx.stats.expanded++;
+
+			for (int e = off[curr]; e < off[curr + 1]; e++)
+			{
+				int nbr = nb[e];
+				if (me.isClosed(nbr)) continue;
+
+				float new_g_cost = me.g_cost[curr] + cst[e];
+				bool in_open = me.isSeen(nbr);
+				if (!in_open || new_g_cost < me.g_cost[nbr])
+				{
+					me.visit(nbr, new_g_cost, curr);
+					float key = new_g_cost + dir * potential(nbr);
+					if (in_open) me.open.decrease(nbr, key);
+					else me.open.push(nbr, key);
+
+					//touched by both sides, candidate path
+					if (other.isSeen(nbr) && new_g_cost + other.g_cost[nbr] < best)
+					{
+						best = new_g_cost + other.g_cost[nbr];
+						meet = nbr;
+					}
+				}
+			}
+		};
+
+		while (!ctx.open.empty() && !bwd.open.empty())
+		{
+			if (ctx.open.topKey() + bwd.open.topKey() >= best) break;
+
+			//grow the smaller frontier
+			if (ctx.open.size() <= bwd.open.size()) step(ctx, bwd, offsets, nbrs, costs, 1);
+			else step(bwd, ctx, in_offsets, in_nbrs, in_costs, -1);
+		}
+
+		if (meet < 0) return {};
+
+		//from -> meet, then follow backward parents to the goal
+		std::vector<int> path = ctx.tracePath(meet);
+		for (int curr = bwd.parent[meet]; curr != -1; curr = bwd.parent[curr])
+		{
+			path.push_back(curr);
+		}
+
+		return path;
+	}
+
+	//goals cut off from the start are turned down before any search,
+	//instead of after expanding everything the start can reach.
+	[[nodiscard]] std::vector<int> route(int from, int to, SearchContext& ctx, const RouteOptions& opts = {}) const
+	{
+		std::vector<int> path;
+		if (!connected(from, to))
+		{
+			ctx.begin(size());
+			return path;
+		}
+
+		switch (opts.mode)
+		{
+		case ROUTE_BIDIRECTIONAL: path = routeBidirectional(from, to, ctx, opts); break;
+		case ROUTE_THETA: path = routeTheta(from, to, ctx, opts); break;
+		case ROUTE_FOCAL: path = routeFocal(from, to, ctx, opts); break;
+		default: path = routeAStar(from, to, ctx, opts); break;
+		}
+
+		if (opts.smooth) smooth(path, opts, &ctx.stats.los_checks);
+		return path;
+	}
+
+	//drops waypoints per opts.smooth, in place
+	void smooth(std::vector<int>& path, const RouteOptions& opts, int* los_checks = nullptr) const
+	{
+		if (!opts.smooth || !opts.obstacles || path.size() <= 2) return;
+		auto keep = smoothPathIndices(path.size(), [&](int i) { return pos[path[i]]; }, *opts.obstacles, los_checks);
+		for (int i = 0; i < (int)keep.size(); i++) path[i] = path[keep[i]];
+		path.resize(keep.size());
+	}
+
+	//uses this thread's scratch context.
+	[[nodiscard]] std::vector<int> route(int from, int to, RouteStats* stats = nullptr, const RouteOptions& opts = {}) const
+	{
+		SearchContext& ctx = SearchContext::local();
+		auto path = route(from, to, ctx, opts);
+		if (stats) *stats = ctx.stats;
+		return path;
+	}
+};
+#endif//NAV_GRAPH_STRUCT_H
@@ -0,0 +1,339 @@
+#pragma once
+#ifndef NAV_GRAPH_FILE_H
+#define NAV_GRAPH_FILE_H
+
+#include "NavGraph.h"
+#include "SearchContext.h"
+#include "return_code.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//binary csr dump of a NavGraph, laid out so it can be used straight
+//from a memory mapped file:
+//  header
+//  float    pos[num_nodes][3]
+//  int32    offsets[num_nodes + 1]
+//  int32    nbrs[num_edges]
+//  float    costs[num_edges]
+//every section is 4 byte aligned and native endian, the header carries
+//a byte order mark so a file from the other kind of machine is rejected.
+//bump NAV_GRAPH_FILE_VERSION whenever the layout changes.
+
+#define NAV_GRAPH_FILE_VERSION 1
+
+struct NavGraphFileHeader
+{
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t version;
+	uint32_t num_nodes;
+	uint32_t num_edges;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+//header flags
+#define NAV_GRAPH_FILE_SYMMETRIC 1u
+
+//read only view over a file image, nothing is copied.
+//valid as long as the memory it was made from.
+struct NavGraphView
+{
+	const float* xyz = nullptr;
+	const int32_t* offsets = nullptr;
+	const int32_t* nbrs = nullptr;
+	const float* costs = nullptr;
+	int num_nodes = 0, num_edges = 0;
+	bool symmetric = false;
+
+	int size() const { return num_nodes; }
+	int numEdges() const { return num_edges; }
+	int degree(int i) const { return offsets[i + 1] - offsets[i]; }
+
+	cmn::vf3d pos(int i) const { return { xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2] }; }
+
+	static size_t fileSize(int num_nodes, int num_edges)
+	{
+		return sizeof(NavGraphFileHeader) + sizeof(float) * 3 * num_nodes +
+			sizeof(int32_t) * (num_nodes + 1) + (sizeof(int32_t) + sizeof(float)) * num_edges;
+	}
+
+	//checks the header and every index, so a truncated or
+	//corrupt file fails here instead of crashing a search later.
+	[[nodiscard]] static ReturnCode makeFromMemory(NavGraphView& view, const void* data, size_t bytes)
+	{
+		view = NavGraphView{};
+		if (!data || bytes < sizeof(NavGraphFileHeader)) return { false, "file too small" };
+
+		NavGraphFileHeader h;
+		std::memcpy(&h, data, sizeof(h));
+		if (std::memcmp(h.magic, "NAVGRAPH", 8) != 0) return { false, "not a navgraph file" };
+		if (h.byte_order != 0x01020304) return { false, "wrong byte order" };
+		if (h.version != NAV_GRAPH_FILE_VERSION) return { false, "unsupported navgraph version" };
+		if (h.num_nodes > 0x7fffffff / 4 || h.num_edges > 0x7fffffff / 4) return { false, "navgraph too large" };
+		if (bytes != fileSize(h.num_nodes, h.num_edges)) return { false, "navgraph size mismatch" };
+		if ((uintptr_t)data % alignof(float) != 0) return { false, "misaligned navgraph data" };
+
+		const char* p = (const char*)data + sizeof(h);
+		view.num_nodes = h.num_nodes;
+		view.num_edges = h.num_edges;
+		view.symmetric = h.flags & NAV_GRAPH_FILE_SYMMETRIC;
+		view.xyz = (const float*)p;
+		p += sizeof(float) * 3 * h.num_nodes;
+		view.offsets = (const int32_t*)p;
+		p += sizeof(int32_t) * (h.num_nodes + 1);
+		view.nbrs = (const int32_t*)p;
+		p += sizeof(int32_t) * h.num_edges;
+		view.costs = (const float*)p;
+
+		if (view.offsets[0] != 0 || view.offsets[view.num_nodes] != view.num_edges)
+		{
+			view = NavGraphView{};
+			return { false, "corrupt navgraph offsets" };
+		}
+		for (int i = 0; i < view.num_nodes; i++)
+		{
+			if (view.offsets[i] > view.offsets[i + 1])
+			{
+				view = NavGraphView{};
+				return { false, "corrupt navgraph offsets" };
+			}
+		}
+		for (int e = 0; e < view.num_edges; e++)
+		{
+			if (view.nbrs[e] < 0 || view.nbrs[e] >= view.num_nodes || !(view.costs[e] >= 0))
+			{
+				view = NavGraphView{};
+				return { false, "corrupt navgraph edges" };
+			}
+		}
+
+		return { true, "success" };
+	}
+
+	//plain A* straight off the mapped arrays, same results as NavGraph::routeAStar
+	[[nodiscard]] std::vector<int> route(int from, int to, SearchContext& ctx) const
+	{
+		ctx.begin(size());
+		if (from < 0 || to < 0 || from >= size() || to >= size() || from == to) return {};
+
+		const cmn::vf3d goal = pos(to);
+		ctx.visit(from, 0, -1);
+		ctx.open.push(from, (pos(from) - goal).mag());
+
+		while (!ctx.open.empty())
+		{
+			int curr = ctx.open.pop();
+			ctx.close(curr);
+			ctx.stats.expanded++;
+
+			if (curr == to) return ctx.tracePath(to);
+
+			for (int e = offsets[curr]; e < offsets[curr + 1]; e++)
+			{
+				int nbr = nbrs[e];
+				if (ctx.isClosed(nbr)) continue;
+
+				float new_g_cost = ctx.g_cost[curr] + costs[e];
+				bool in_open = ctx.isSeen(nbr);
+				if (!in_open || new_g_cost < ctx.g_cost[nbr])
+				{
+					ctx.visit(nbr, new_g_cost, curr);
+					float f_cost = new_g_cost + (pos(nbr) - goal).mag();
+					if (in_open) ctx.open.decrease(nbr, f_cost);
+					else ctx.open.push(nbr, f_cost);
+				}
+			}
+		}
+
+		return {};
+	}
+
+	[[nodiscard]] std::vector<int> route(int from, int to, RouteStats* stats = nullptr) const
+	{
+		SearchContext& ctx = SearchContext::local();
+		auto path = route(from, to, ctx);
+		if (stats) *stats = ctx.stats;
+		return path;
+	}
+
+	//full copy into a regular NavGraph (reverse edges and components rebuilt, no nodes),
+	//for the modes the view doesnt have.
+	NavGraph toNavGraph() const
+	{
+		NavGraph nav;
+		nav.pos.resize(size());
+		for (int i = 0; i < size(); i++) nav.pos[i] = pos(i);
+		nav.offsets.assign(offsets, offsets + size() + 1);
+		nav.nbrs.assign(nbrs, nbrs + numEdges());
+		nav.costs.assign(costs, costs + numEdges());
+		nav.buildReverse();
+		nav.buildComponents();
+		return nav;
+	}
+};
+
+//whole file in memory, mapped where the os allows it.
+//move only, unmaps on destruction.
+class MappedFile
+{
+	const void* ptr = nullptr;
+	size_t bytes = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+	void close()
+	{
+#ifdef _WIN32
+		if (ptr) UnmapViewOfFile(ptr);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#else
+		if (ptr) munmap((void*)ptr, bytes);
+#endif
+		ptr = nullptr, bytes = 0;
+	}
+
+public:
+	MappedFile() {}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+
+	MappedFile& operator=(MappedFile&& o) noexcept
+	{
+		if (&o == this) return *this;
+		close();
+		std::swap(ptr, o.ptr);
+		std::swap(bytes, o.bytes);
+#ifdef _WIN32
+		std::swap(file, o.file);
+		std::swap(mapping, o.mapping);
+#endif
+		return *this;
+	}
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	const void* data() const { return ptr; }
+	size_t size() const { return bytes; }
+
+	[[nodiscard]] static ReturnCode open(MappedFile& m, const std::string& filename)
+	{
+		m.close();
+#ifdef _WIN32
+		m.file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m.file == INVALID_HANDLE_VALUE) return { false, "invalid filename" };
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m.file, &size) || size.QuadPart == 0)
+		{
+			m.close();
+			return { false, "empty file" };
+		}
+		m.mapping = CreateFileMappingA(m.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m.mapping)
+		{
+			m.close();
+			return { false, "could not map file" };
+		}
+		m.ptr = MapViewOfFile(m.mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m.ptr)
+		{
+			m.close();
+			return { false, "could not map file" };
+		}
+		m.bytes = size.QuadPart;
+#else
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0) return { false, "invalid filename" };
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			::close(fd);
+			return { false, "empty file" };
+		}
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED) return { false, "could not map file" };
+		m.ptr = p;
+		m.bytes = st.st_size;
+#endif
+		return { true, "success" };
+	}
+};
+
+//a mapped file and the view into it, kept together so the view cant
+//outlive its memory. this is the "load in milliseconds" path: open()
+//costs a validation pass over the indices and nothing else.
+struct MappedNavGraph
+{
+	MappedFile file;
+	NavGraphView view;
+
+	[[nodiscard]] static ReturnCode open(MappedNavGraph& m, const std::string& filename)
+	{
+		m.view = NavGraphView{};
+		ReturnCode status = MappedFile::open(m.file, filename);
+		if (!status.valid) return status;
+		return NavGraphView::makeFromMemory(m.view, m.file.data(), m.file.size());
+	}
+};
+
+[[nodiscard]] static ReturnCode saveNavGraph(const NavGraph& nav, const std::string& filename)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (file.fail()) return { false, "invalid filename" };
+
+	NavGraphFileHeader h{};
+	std::memcpy(h.magic, "NAVGRAPH", 8);
+	h.byte_order = 0x01020304;
+	h.version = NAV_GRAPH_FILE_VERSION;
+	h.num_nodes = nav.size();
+	h.num_edges = nav.numEdges();
+	h.flags = nav.symmetric ? NAV_GRAPH_FILE_SYMMETRIC : 0;
+	file.write((const char*)&h, sizeof(h));
+
+	std::vector<float> xyz;
+	xyz.reserve(3 * nav.size());
+	for (const auto& p : nav.pos) xyz.insert(xyz.end(), { p.x, p.y, p.z });
+	file.write((const char*)xyz.data(), sizeof(float) * xyz.size());
+
+	static_assert(sizeof(int) == sizeof(int32_t), "csr arrays are written as is");
+	file.write((const char*)nav.offsets.data(), sizeof(int32_t) * nav.offsets.size());
+	file.write((const char*)nav.nbrs.data(), sizeof(int32_t) * nav.nbrs.size());
+	file.write((const char*)nav.costs.data(), sizeof(float) * nav.costs.size());
+
+	//the last writes can sit in the buffer until the flush on close
+	file.close();
+	if (file.fail()) return { false, "write failed" };
+	return { true, "success" };
+}
+
+#endif//NAV_GRAPH_FILE_H
@@ -1,18 +1,99 @@
 #pragma once
-#include <list>
+#include "NodePool.h"
+
+#include <cstring>
+
+struct Node;
+
+//a node's links as one array, in the order they were added.
+//with a pool it comes from the owning graph's link spans, see SpanPool,
+//else from operator new. grows by doubling, erase shifts the rest down.
+class LinkArray
+{
+	Node** data = nullptr;
+	int count = 0;
+	//size class of data, -1 while nothing is allocated
+	int cls = -1;
+	SpanPool* pool = nullptr;
+
+	void* allocate(int c) { return pool ? pool->allocate(c) : ::operator new(sizeof(Node*) * SpanPool::capacity(c)); }
+
+	void free()
+	{
+		if (cls < 0) return;
+		if (pool) pool->deallocate(data, cls);
+		else ::operator delete(data);
+		data = nullptr;
+		cls = -1;
+	}
+
+public:
+	typedef Node** iterator;
+	typedef Node* const* const_iterator;
+
+	LinkArray() {}
+
+	explicit LinkArray(SpanPool* p) : pool(p) {}
+
+	LinkArray(const LinkArray&) = delete;
+	LinkArray& operator=(const LinkArray&) = delete;
+
+	~LinkArray() { free(); }
+
+	iterator begin() { return data; }
+	iterator end() { return data + count; }
+	const_iterator begin() const { return data; }
+	const_iterator end() const { return data + count; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	size_t capacity() const { return cls < 0 ? 0 : SpanPool::capacity(cls); }
+
+	Node* operator[](size_t i) const { return data[i]; }
+
+	//room for n links without moving
+	void reserve(int n)
+	{
+		if (n <= (int)capacity()) return;
+		int c = SpanPool::spanClass(n);
+		Node** grown = static_cast<Node**>(allocate(c));
+		if (count) std::memcpy(grown, data, sizeof(Node*) * count);
+		free();
+		data = grown;
+		cls = c;
+	}
+
+	void push_back(Node* n)
+	{
+		if (count == (int)capacity()) reserve(count + 1);
+		data[count++] = n;
+	}
+
+	void emplace_back(Node* n) { push_back(n); }
+
+	iterator erase(iterator it)
+	{
+		std::memmove(it, it + 1, sizeof(Node*) * (end() - it - 1));
+		count--;
+		return it;
+	}
+
+	void clear() { count = 0; }
+};
 
 struct Node
 {
-	std::list<Node*> links;
+	LinkArray links;
 	cmn::vf3d pos;
+	//index in the graph's last freeze, search state lives in a SearchContext
 	int id = -1;
-	float g_cost = 0, h_cost = 0, f_cost = 0;
-	Node* parent = nullptr;
 
 	Node() = delete;
 
 	Node(cmn::vf3d p) : pos(p) {}
 
+	Node(cmn::vf3d p, SpanPool* link_pool) : links(link_pool), pos(p) {}
+
 	//dont copy links?
 	//negative id to differentiate original, and copy
 	Node(const Node& n) : pos(n.pos), id(-n.id) {}
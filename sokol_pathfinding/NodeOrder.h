@@ -0,0 +1,180 @@
+#pragma once
+#ifndef NODE_ORDER_H
+#define NODE_ORDER_H
+
+#include "Node.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//how NavGraph::makeFromNodes numbers the nodes. searches walk from a
+//node to its neighbors, so the closer neighbors sit in the index range,
+//the more of their pos/offsets/costs/search state share cache lines.
+//list order is whatever order the nodes were added in, which for
+//sampled waypoints scatters neighbors all over the arrays.
+enum NodeOrder
+{
+	ORDER_LIST,
+	//along a hilbert curve over x/z, needs positions only
+	ORDER_HILBERT,
+	//reverse cuthill-mckee, bfs layers from a peripheral node, needs links only
+	ORDER_RCM
+};
+
+//distance along a hilbert curve through a 2^16 x 2^16 grid
+uint64_t hilbertIndex(uint32_t x, uint32_t y)
+{
+	const uint32_t n = 1u << 16;
+	uint64_t d = 0;
+	for (uint32_t s = n / 2; s > 0; s /= 2)
+	{
+		uint32_t rx = (x & s) > 0;
+		uint32_t ry = (y & s) > 0;
+		d += (uint64_t)s * s * ((3 * rx) ^ ry);
+
+		//rotate the quadrant so the curve stays continuous
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+//sorts nodes along a hilbert curve over their bounding box on x/z
+void orderHilbert(std::vector<Node*>& nodes)
+{
+	if (nodes.size() < 2) return;
+
+	float min_x = INFINITY, min_z = INFINITY, max_x = -INFINITY, max_z = -INFINITY;
+	for (const auto& n : nodes)
+	{
+		min_x = std::min(min_x, n->pos.x), max_x = std::max(max_x, n->pos.x);
+		min_z = std::min(min_z, n->pos.z), max_z = std::max(max_z, n->pos.z);
+	}
+	//same scale on both axes, so the curve's cells stay square
+	float scale = 65535 / std::max(1e-6f, std::max(max_x - min_x, max_z - min_z));
+
+	std::vector<std::pair<uint64_t, Node*>> keyed;
+	keyed.reserve(nodes.size());
+	for (const auto& n : nodes)
+	{
+		uint32_t x = (n->pos.x - min_x) * scale;
+		uint32_t z = (n->pos.z - min_z) * scale;
+		keyed.push_back({ hilbertIndex(x, z), n });
+	}
+	//stable, so coincident nodes keep their list order
+	std::stable_sort(keyed.begin(), keyed.end(),
+		[](const std::pair<uint64_t, Node*>& a, const std::pair<uint64_t, Node*>& b) { return a.first < b.first; });
+
+	for (int i = 0; i < (int)nodes.size(); i++) nodes[i] = keyed[i].second;
+}
+
+//reverse cuthill-mckee over the links, taken as two way.
+//each component starts from the last node a bfs from its first node
+//reaches, which is about as far out as the component goes.
+//uses Node::id for scratch, makeFromNodes renumbers afterwards.
+void orderCuthillMcKee(std::vector<Node*>& nodes)
+{
+	const int n = nodes.size();
+	if (n < 2) return;
+	for (int i = 0; i < n; i++) nodes[i]->id = i;
+	auto index = [&](const Node* l) {
+		return l->id >= 0 && l->id < n && nodes[l->id] == l ? l->id : -1;
+	};
+
+	//two way adjacency in csr form, links can be one way
+	std::vector<int> off(n + 1, 0), adj;
+	for (int i = 0; i < n; i++)
+	{
+		for (const auto& l : nodes[i]->links)
+		{
+			int j = index(l);
+			if (j < 0 || j == i) continue;
+			off[i + 1]++, off[j + 1]++;
+		}
+	}
+	for (int i = 0; i < n; i++) off[i + 1] += off[i];
+	adj.resize(off[n]);
+	std::vector<int> fill(off.begin(), off.end() - 1);
+	for (int i = 0; i < n; i++)
+	{
+		for (const auto& l : nodes[i]->links)
+		{
+			int j = index(l);
+			if (j < 0 || j == i) continue;
+			adj[fill[i]++] = j;
+			adj[fill[j]++] = i;
+		}
+	}
+	//two way links show up twice, count them once
+	std::vector<int> degree(n);
+	for (int i = 0; i < n; i++)
+	{
+		std::sort(adj.begin() + off[i], adj.begin() + off[i + 1]);
+		degree[i] = std::unique(adj.begin() + off[i], adj.begin() + off[i + 1]) - (adj.begin() + off[i]);
+	}
+	auto by_degree = [&](int a, int b) {
+		return degree[a] != degree[b] ? degree[a] < degree[b] : a < b;
+	};
+
+	std::vector<int> order;
+	order.reserve(n);
+	std::vector<int> level(n, -1);
+
+	//bfs from root in cuthill-mckee order, appended to out. returns the last node.
+	std::vector<int> nbrs;
+	auto bfs = [&](int root, std::vector<int>& out, int mark) {
+		size_t head = out.size();
+		out.push_back(root);
+		level[root] = mark;
+		while (head < out.size())
+		{
+			int curr = out[head++];
+			nbrs.clear();
+			for (int e = off[curr]; e < off[curr] + degree[curr]; e++)
+			{
+				int j = adj[e];
+				if (level[j] != mark) nbrs.push_back(j), level[j] = mark;
+			}
+			std::sort(nbrs.begin(), nbrs.end(), by_degree);
+			out.insert(out.end(), nbrs.begin(), nbrs.end());
+		}
+		return out.back();
+	};
+
+	std::vector<int> probe;
+	for (int i = 0; i < n; i++)
+	{
+		if (level[i] >= 0) continue;
+		//pseudo peripheral start: the far end of a bfs from i
+		probe.clear();
+		int far = bfs(i, probe, 0);
+		for (const auto& p : probe) level[p] = -1;
+		bfs(far, order, 1);
+	}
+
+	std::reverse(order.begin(), order.end());
+	std::vector<Node*> sorted(n);
+	for (int i = 0; i < n; i++) sorted[i] = nodes[order[i]];
+	nodes.swap(sorted);
+}
+
+void orderNodes(std::vector<Node*>& nodes, NodeOrder order)
+{
+	switch (order)
+	{
+	case ORDER_HILBERT: orderHilbert(nodes); break;
+	case ORDER_RCM: orderCuthillMcKee(nodes); break;
+	default: break;
+	}
+}
+#endif//NODE_ORDER_H
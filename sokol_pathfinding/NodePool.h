@@ -0,0 +1,181 @@
+#pragma once
+#ifndef NODE_POOL_CLASS_H
+#define NODE_POOL_CLASS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+//fixed size block allocator. blocks come out of big chunks, freed
+//blocks go on an intrusive free list and are reused first.
+//reset() takes every block back at once but keeps the chunks, so
+//refilling is free of both mallocs and first touch page faults,
+//release() hands the chunks back too. a graph owns one for its nodes
+//and a SpanPool of them for their links, so building, cloning and
+//clearing a graph is a few big allocations instead of one per node and
+//per link.
+//not thread safe, same as editing the graph that owns it.
+class FixedPool
+{
+	size_t block, align;
+	std::vector<char*> chunks;
+	void* free_head = nullptr;
+	//blocks are carved from chunks[current], the ones after it are spare
+	int current = -1, used = 0;
+	int live = 0;
+
+	static constexpr int min_chunk = 256, max_chunk = 1 << 16;
+
+	static int chunkBlocks(int i) { return i < 8 ? min_chunk << i : max_chunk; }
+
+	void nextChunk()
+	{
+		current++;
+		used = 0;
+		if (current == (int)chunks.size())
+		{
+			chunks.push_back(static_cast<char*>(::operator new(block * chunkBlocks(current))));
+		}
+	}
+
+public:
+	//blocks are rounded up so every one stays aligned to alignment,
+	//which can be at most max_align_t's
+	FixedPool(size_t block_size, size_t alignment = alignof(std::max_align_t))
+	{
+		align = std::min(std::max(alignment, alignof(void*)), alignof(std::max_align_t));
+		block = (std::max(block_size, sizeof(void*)) + align - 1) / align * align;
+	}
+
+	FixedPool(const FixedPool&) = delete;
+	FixedPool& operator=(const FixedPool&) = delete;
+
+	~FixedPool()
+	{
+		release();
+	}
+
+	size_t blockSize() const { return block; }
+	size_t alignment() const { return align; }
+
+	//blocks handed out and not given back
+	int numLive() const { return live; }
+
+	size_t memoryUsage() const
+	{
+		size_t total = 0;
+		for (int i = 0; i < (int)chunks.size(); i++) total += block * chunkBlocks(i);
+		return total;
+	}
+
+	void* allocate()
+	{
+		live++;
+		if (free_head)
+		{
+			void* p = free_head;
+			free_head = *static_cast<void**>(p);
+			return p;
+		}
+		if (current < 0 || used == chunkBlocks(current)) nextChunk();
+		return chunks[current] + block * used++;
+	}
+
+	void deallocate(void* p)
+	{
+		if (!p) return;
+		live--;
+		*static_cast<void**>(p) = free_head;
+		free_head = p;
+	}
+
+	//takes every block back, keeps the memory.
+	//whatever lived in them must be dead already.
+	void reset()
+	{
+		free_head = nullptr;
+		current = -1;
+		used = live = 0;
+	}
+
+	//same, and frees the memory
+	void release()
+	{
+		reset();
+		for (auto& c : chunks) ::operator delete(c);
+		chunks.clear();
+	}
+};
+
+//arrays of elem_size elements in power of two lengths, one FixedPool
+//per length, for lists that grow by doubling. class c holds
+//min_span << c elements. longer arrays than the last class holds go to
+//operator new and count as spilled.
+//a graph keeps every node's links in one of these, see LinkArray in Node.h.
+class SpanPool
+{
+public:
+	static constexpr int num_classes = 6, min_span = 2;
+
+private:
+	size_t elem, align;
+	std::unique_ptr<FixedPool> pools[num_classes];
+	int spilled = 0;
+
+public:
+	SpanPool(size_t elem_size, size_t alignment = alignof(std::max_align_t)) : elem(elem_size), align(alignment)
+	{
+		for (int c = 0; c < num_classes; c++) pools[c] = std::make_unique<FixedPool>(elem * (min_span << c), alignment);
+	}
+
+	SpanPool(const SpanPool&) = delete;
+	SpanPool& operator=(const SpanPool&) = delete;
+
+	static int capacity(int cls) { return min_span << cls; }
+
+	//smallest class that holds n elements
+	static int spanClass(int n)
+	{
+		int c = 0;
+		while (capacity(c) < n) c++;
+		return c;
+	}
+
+	int numSpilled() const { return spilled; }
+
+	size_t memoryUsage() const
+	{
+		size_t total = 0;
+		for (const auto& p : pools) total += p->memoryUsage();
+		return total;
+	}
+
+	void* allocate(int cls)
+	{
+		if (cls < num_classes) return pools[cls]->allocate();
+		spilled++;
+		return ::operator new(elem * capacity(cls));
+	}
+
+	void deallocate(void* p, int cls)
+	{
+		if (cls < num_classes) pools[cls]->deallocate(p);
+		else ::operator delete(p);
+	}
+
+	//same as FixedPool's, for every class
+	void reset()
+	{
+		for (auto& p : pools) p->reset();
+		spilled = 0;
+	}
+
+	void release()
+	{
+		for (auto& p : pools) p->release();
+		spilled = 0;
+	}
+};
+#endif//NODE_POOL_CLASS_H
@@ -8,6 +8,8 @@
 
 #include "math/mat4.h"
 
+#include "TriangleBVH.h"
+
 enum objectType
 {
 	OBJECT,
@@ -72,6 +74,20 @@ struct Object {
 		return box;
 	}
 
+	//world space triangles, e.g. for an obstacle bvh.
+	//intersectRay works in mesh space, this applies the model matrix.
+	void addTrianglesTo(TriangleBVH& bvh) const
+	{
+		for (const auto& t : mesh.tris)
+		{
+			float wa = 1, wb = 1, wc = 1;
+			bvh.addTriangle(
+				matMulVec(model, mesh.verts[t.a].pos, wa),
+				matMulVec(model, mesh.verts[t.b].pos, wb),
+				matMulVec(model, mesh.verts[t.c].pos, wc));
+		}
+	}
+
 	float random() const
 	{
 		static const float rand_max = RAND_MAX;
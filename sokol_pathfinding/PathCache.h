@@ -0,0 +1,210 @@
+#pragma once
+#ifndef PATH_CACHE_CLASS_H
+#define PATH_CACHE_CLASS_H
+
+#include "Graph.h"
+
+#include <list>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+
+//bounded lru cache of Graph::route results keyed by (from, to) and the
+//route options that change the result.
+//the cache remembers the graph version its entries were found on and
+//drops everything the first time it sees a newer one, so any edit
+//(addNode, addLink, removeNode, markDirty..) invalidates it.
+//unreachable goals are cached too, those are the most expensive misses.
+//one mutex guards the table, searches run outside it.
+//use one cache per graph. landmarks and obstacles are keyed by address,
+//rebuilding them in place needs a clear().
+class PathCache
+{
+	struct Key
+	{
+		Node* from;
+		Node* to;
+		RouteMode mode;
+		float weight;
+		bool smooth;
+		const Landmarks* landmarks;
+		const TriangleBVH* obstacles;
+
+		Key(Node* from, Node* to, const RouteOptions& opts) : from(from), to(to), mode(opts.mode),
+			weight(opts.weight), smooth(opts.smooth), landmarks(opts.landmarks), obstacles(opts.obstacles) {}
+
+		bool operator==(const Key& k) const
+		{
+			return from == k.from && to == k.to && mode == k.mode && weight == k.weight &&
+				smooth == k.smooth && landmarks == k.landmarks && obstacles == k.obstacles;
+		}
+	};
+
+	struct KeyHash
+	{
+		static size_t combine(size_t a, size_t b) { return a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2)); }
+
+		size_t operator()(const Key& k) const
+		{
+			size_t h = combine(std::hash<Node*>()(k.from), std::hash<Node*>()(k.to));
+			h = combine(h, std::hash<int>()(k.mode * 2 + k.smooth));
+			h = combine(h, std::hash<float>()(k.weight));
+			h = combine(h, std::hash<const void*>()(k.landmarks));
+			return combine(h, std::hash<const void*>()(k.obstacles));
+		}
+	};
+
+	struct Entry
+	{
+		Key key;
+		std::vector<Node*> path;
+	};
+
+	size_t max_entries;
+
+	//front is most recently used
+	std::list<Entry> entries;
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> table;
+	unsigned version = 0;
+
+	mutable std::mutex mutex;
+
+public:
+	struct Stats
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+		size_t invalidations = 0;
+		size_t entries = 0;
+
+		double hitRate() const { return hits + misses ? double(hits) / (hits + misses) : 0; }
+	};
+
+private:
+	Stats counts;
+
+	//caller holds mutex
+	void sync(unsigned graph_version)
+	{
+		if (graph_version == version) return;
+		if (!entries.empty()) counts.invalidations++;
+		entries.clear();
+		table.clear();
+		version = graph_version;
+	}
+
+public:
+	PathCache(size_t capacity = 1024) : max_entries(capacity ? capacity : 1) {}
+
+	PathCache(const PathCache&) = delete;
+	PathCache& operator=(const PathCache&) = delete;
+
+	//true and fills path if (from, to) was cached with the same options for this graph version.
+	bool lookup(const Graph& g, Node* from, Node* to, std::vector<Node*>& path, const RouteOptions& opts = {})
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		sync(g.version);
+
+		auto it = table.find(Key(from, to, opts));
+		if (it == table.end())
+		{
+			counts.misses++;
+			return false;
+		}
+
+		counts.hits++;
+		entries.splice(entries.begin(), entries, it->second);
+		path = it->second->path;
+		return true;
+	}
+
+	//remember a path found on graph_version.
+	//dropped if the graph moved on while it was being searched.
+	void insert(unsigned graph_version, Node* from, Node* to, const std::vector<Node*>& path, const RouteOptions& opts = {})
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		//versions only go up, so an older one means a stale result
+		if (int(graph_version - version) < 0) return;
+		sync(graph_version);
+
+		Key key(from, to, opts);
+		auto it = table.find(key);
+		if (it != table.end())
+		{
+			it->second->path = path;
+			entries.splice(entries.begin(), entries, it->second);
+			return;
+		}
+
+		entries.push_front({ key, path });
+		table.emplace(key, entries.begin());
+
+		while (entries.size() > max_entries)
+		{
+			table.erase(entries.back().key);
+			entries.pop_back();
+			counts.evictions++;
+		}
+	}
+
+	//cached Graph::route. stats->expanded is 0 on a hit.
+	//same rules as Graph::route: fine from many threads, not during edits.
+	[[nodiscard]] std::vector<Node*> route(const Graph& g, Node* from, Node* to, RouteStats* stats = nullptr, const RouteOptions& opts = {})
+	{
+		std::vector<Node*> path;
+		if (lookup(g, from, to, path, opts))
+		{
+			if (stats) *stats = {};
+			return path;
+		}
+
+		unsigned searched_version = g.version;
+		path = g.route(from, to, stats, opts);
+		insert(searched_version, from, to, path, opts);
+		return path;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		entries.clear();
+		table.clear();
+	}
+
+	void resetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		counts = {};
+	}
+
+	Stats stats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Stats s = counts;
+		s.entries = entries.size();
+		return s;
+	}
+
+	size_t capacity() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return max_entries;
+	}
+
+	//shrinking evicts the least recently used entries
+	void setCapacity(size_t capacity)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		max_entries = capacity ? capacity : 1;
+		while (entries.size() > max_entries)
+		{
+			table.erase(entries.back().key);
+			entries.pop_back();
+			counts.evictions++;
+		}
+	}
+};
+#endif//PATH_CACHE_CLASS_H
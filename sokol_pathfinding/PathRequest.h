@@ -0,0 +1,168 @@
+#pragma once
+#ifndef PATH_REQUEST_CLASS_H
+#define PATH_REQUEST_CLASS_H
+
+#include "NavGraph.h"
+#include "SearchContext.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+enum PathStatus
+{
+	PATH_IDLE,
+	PATH_SEARCHING,
+	PATH_FOUND,
+	PATH_NOT_FOUND
+};
+
+//A* that can be paused and resumed, so one long query can be spread
+//over several frames instead of stalling one. each step() hands the
+//search to NavGraph::stepAStar for at most max_expansions nodes or about
+//max_us, whichever ends first, then hands back. the search state lives in the request's own context, and the
+//snapshot is shared, so graph edits in between dont disturb it.
+//bidirectional, Theta* and focal dont slice, any mode searches as ROUTE_ASTAR.
+//landmarks, weight and smoothing from the options are honored.
+class PathRequest
+{
+	std::shared_ptr<const NavGraph> nav;
+	SearchContext ctx;
+	RouteOptions opts;
+	int from = -1, to = -1;
+	PathStatus status = PATH_IDLE;
+
+	//closed node closest to the goal, end of the partial path
+	int best = -1;
+	float best_h = INFINITY;
+
+	std::vector<int> path;
+	int slices = 0;
+	double elapsed_us = 0;
+
+	//the clock isnt free, so it is only read every this many expansions
+	static const int clock_stride = 32;
+
+	typedef std::chrono::steady_clock Clock;
+
+	void finish(PathStatus s)
+	{
+		status = s;
+		if (s == PATH_FOUND)
+		{
+			path = ctx.tracePath(to);
+			nav->smooth(path, opts, &ctx.stats.los_checks);
+		}
+	}
+
+public:
+	PathRequest() {}
+
+	//drops whatever was running and starts from -> to.
+	//from == to, an index outside the snapshot or a goal in another
+	//component ends it right away.
+	void start(std::shared_ptr<const NavGraph> snapshot, int from_, int to_, const RouteOptions& opts_ = {})
+	{
+		nav = std::move(snapshot);
+		from = from_, to = to_;
+		opts = opts_;
+		best = -1, best_h = INFINITY;
+		path.clear();
+		slices = 0;
+		elapsed_us = 0;
+
+		const int n = nav ? nav->size() : 0;
+		ctx.begin(n);
+		if (from < 0 || to < 0 || from >= n || to >= n || from == to || !nav->connected(from, to))
+		{
+			status = PATH_NOT_FOUND;
+			return;
+		}
+
+		status = PATH_SEARCHING;
+		nav->beginAStar(from, to, ctx, opts);
+	}
+
+	//node flavored start, nodes the snapshot doesnt know fail right away
+	void start(std::shared_ptr<const NavGraph> snapshot, const Node* from_, const Node* to_, const RouteOptions& opts_ = {})
+	{
+		int f = snapshot ? snapshot->indexOf(from_) : -1;
+		int t = snapshot ? snapshot->indexOf(to_) : -1;
+		start(std::move(snapshot), f, t, opts_);
+	}
+
+	//forget the query and the snapshot
+	void cancel()
+	{
+		nav.reset();
+		status = PATH_IDLE;
+		path.clear();
+		best = -1;
+	}
+
+	//one time slice. returns the status afterwards.
+	PathStatus step(int max_expansions, float max_us = INFINITY)
+	{
+		if (status != PATH_SEARCHING) return status;
+
+		const Clock::time_point begin = Clock::now();
+		const bool timed = !std::isinf(max_us);
+		slices++;
+
+		int i = 0;
+		AStarStep res = nav->stepAStar(to, ctx, opts, max_expansions, [&](int curr) {
+			float h = nav->estimate(curr, to, opts);
+			if (h < best_h) best_h = h, best = curr;
+
+			return !timed || ++i % clock_stride != 0 ||
+				std::chrono::duration<float, std::micro>(Clock::now() - begin).count() < max_us;
+		});
+		if (res == ASTAR_FOUND) finish(PATH_FOUND);
+		else if (res == ASTAR_NO_PATH) finish(PATH_NOT_FOUND);
+
+		elapsed_us += std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+		return status;
+	}
+
+	//runs to the end in one go, for callers that stop caring about frames
+	PathStatus finishNow()
+	{
+		while (status == PATH_SEARCHING) step(1 << 30);
+		return status;
+	}
+
+	PathStatus getStatus() const { return status; }
+	bool done() const { return status != PATH_SEARCHING; }
+	bool found() const { return status == PATH_FOUND; }
+
+	//from -> to once found, empty otherwise
+	const std::vector<int>& result() const { return path; }
+
+	//best guess so far: the full path once found, else from -> the
+	//expanded node closest to the goal, for agents that start walking
+	//before the search is done. empty before the first step.
+	std::vector<int> bestPath() const
+	{
+		if (status == PATH_FOUND) return path;
+		if (best < 0) return {};
+		return ctx.tracePath(best);
+	}
+
+	//node flavored result, same rules as bestPath
+	std::vector<Node*> bestNodePath() const
+	{
+		std::vector<Node*> out;
+		if (!nav || nav->nodes.empty()) return out;
+		for (const auto& i : bestPath()) out.push_back(nav->nodes[i]);
+		return out;
+	}
+
+	const RouteStats& stats() const { return ctx.stats; }
+	int numSlices() const { return slices; }
+	double elapsedUs() const { return elapsed_us; }
+
+	const std::shared_ptr<const NavGraph>& snapshot() const { return nav; }
+};
+#endif//PATH_REQUEST_CLASS_H
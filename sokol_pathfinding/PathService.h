@@ -0,0 +1,280 @@
+#pragma once
+#ifndef PATH_SERVICE_CLASS_H
+#define PATH_SERVICE_CLASS_H
+
+#include "NavGraph.h"
+#include "SearchContext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//0 is never handed out
+typedef uint32_t PathTicket;
+
+struct PathResult
+{
+	PathTicket ticket = 0;
+	int from = -1, to = -1;
+
+	//indexes into nav, empty if there is no path
+	std::vector<int> path;
+	RouteStats stats;
+	std::shared_ptr<const NavGraph> nav;
+
+	bool found() const { return !path.empty(); }
+};
+
+//background route service. the owning thread (the frame loop) submits
+//requests and gets tickets back, worker threads search, and poll() at
+//the start of the next frame runs the completion callbacks on the
+//owning thread, so callbacks can touch game state freely.
+//submit, cancel and poll are for the owning thread only.
+//
+//submitting never takes a lock: requests go onto a lock free stack the
+//workers take whole, and finished ones come back the same way. the only
+//mutex the owner touches is the wake up one, and only while a worker
+//is asleep. workers sort what they take by priority between them.
+class PathService
+{
+public:
+	typedef std::function<void(const PathResult&)> Callback;
+
+private:
+	struct Job
+	{
+		Job* next = nullptr;
+		uint64_t seq = 0;
+		int priority = 0;
+		std::shared_ptr<const NavGraph> nav;
+		RouteOptions opts;
+		Callback done;
+		std::atomic<bool> cancelled{ false };
+		PathResult result;
+	};
+
+	//multi producer stack, consumers take everything at once, so no ABA.
+	//left seq_cst, the sleep check in workerLoop relies on it.
+	struct JobStack
+	{
+		std::atomic<Job*> head{ nullptr };
+
+		void push(Job* j)
+		{
+			j->next = head.load();
+			while (!head.compare_exchange_weak(j->next, j));
+		}
+
+		Job* takeAll() { return head.exchange(nullptr); }
+
+		bool empty() const { return head.load() == nullptr; }
+	};
+
+	JobStack inbox, outbox;
+
+	//workers only: jobs taken from the inbox, best first
+	std::mutex queue_mutex;
+	std::vector<Job*> queue;
+	//queue.size(), readable outside queue_mutex for the sleep check
+	std::atomic<int> queued{ 0 };
+
+	//higher priority first, then oldest first
+	static bool later(const Job* a, const Job* b)
+	{
+		if (a->priority != b->priority) return a->priority < b->priority;
+		return a->seq > b->seq;
+	}
+
+	std::vector<std::thread> workers;
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+	std::atomic<int> sleepers{ 0 };
+	std::atomic<bool> stopping{ false };
+
+	//owning thread only
+	std::unordered_map<PathTicket, Job*> live;
+	PathTicket last_ticket = 0;
+	uint64_t next_seq = 0;
+
+	Job* popBest()
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		for (Job* j = inbox.takeAll(); j;)
+		{
+			Job* next = j->next;
+			queue.push_back(j);
+			std::push_heap(queue.begin(), queue.end(), later);
+			j = next;
+		}
+		if (queue.empty()) return nullptr;
+		std::pop_heap(queue.begin(), queue.end(), later);
+		Job* j = queue.back();
+		queue.pop_back();
+		queued = queue.size();
+		return j;
+	}
+
+	void wakeOne()
+	{
+		if (sleepers == 0) return;
+		//pairs with the predicate check in workerLoop
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex);
+		}
+		wake.notify_one();
+	}
+
+	void run(Job& j, SearchContext& ctx)
+	{
+		//cancelled while queued, skip the search and just hand it back
+		if (j.cancelled) return;
+		j.result.path = j.nav->route(j.result.from, j.result.to, ctx, j.opts);
+		j.result.stats = ctx.stats;
+	}
+
+	void workerLoop()
+	{
+		SearchContext ctx;
+		while (!stopping)
+		{
+			if (Job* j = popBest())
+			{
+				//took a batch from the inbox, someone else can have the rest
+				if (queued > 0) wakeOne();
+				run(*j, ctx);
+				outbox.push(j);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(wake_mutex);
+			//seq_cst against submit and popBest: either we see their
+			//jobs, or they see us asleep
+			sleepers++;
+			wake.wait(lock, [&] { return stopping || !inbox.empty() || queued > 0; });
+			sleepers--;
+		}
+	}
+
+public:
+	//num_threads workers, the owning thread never searches
+	PathService(int num_threads = std::max(1, (int)std::thread::hardware_concurrency() - 1))
+	{
+		num_threads = std::max(1, num_threads);
+		for (int i = 0; i < num_threads; i++)
+		{
+			workers.emplace_back(&PathService::workerLoop, this);
+		}
+	}
+
+	PathService(const PathService&) = delete;
+	PathService& operator=(const PathService&) = delete;
+
+	//waits for running searches, drops everything else without callbacks
+	~PathService()
+	{
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& w : workers) w.join();
+
+		for (auto& l : live) delete l.second;
+	}
+
+	int numThreads() const { return workers.size(); }
+
+	//submitted and not yet handed back by poll()
+	int pending() const { return live.size(); }
+
+	//queue from -> to against a snapshot, higher priority runs first.
+	//done runs inside a later poll(), unless the ticket is cancelled first.
+	PathTicket submit(std::shared_ptr<const NavGraph> nav, int from, int to,
+		Callback done = nullptr, int priority = 0, const RouteOptions& opts = {})
+	{
+		Job* j = new Job;
+		if (++last_ticket == 0) last_ticket = 1;
+		j->seq = next_seq++;
+		j->priority = priority;
+		j->opts = opts;
+		j->done = std::move(done);
+		j->result.ticket = last_ticket;
+		j->result.from = from;
+		j->result.to = to;
+		j->result.nav = nav;
+		j->nav = std::move(nav);
+		live[last_ticket] = j;
+
+		inbox.push(j);
+		wakeOne();
+		return last_ticket;
+	}
+
+	//node flavored, nodes the snapshot doesnt know give an empty path
+	PathTicket submit(std::shared_ptr<const NavGraph> nav, const Node* from, const Node* to,
+		Callback done = nullptr, int priority = 0, const RouteOptions& opts = {})
+	{
+		int f = nav ? nav->indexOf(from) : -1;
+		int t = nav ? nav->indexOf(to) : -1;
+		return submit(std::move(nav), f, t, std::move(done), priority, opts);
+	}
+
+	//its callback will not run. a search already underway finishes
+	//in the background and is thrown away. false for unknown tickets.
+	bool cancel(PathTicket ticket)
+	{
+		auto it = live.find(ticket);
+		if (it == live.end() || it->second->cancelled) return false;
+		it->second->cancelled = true;
+		it->second->done = nullptr;
+		return true;
+	}
+
+	//runs callbacks for everything finished since the last poll,
+	//in the order they finished. returns how many callbacks ran.
+	int poll()
+	{
+		//the stack hands them back newest first
+		Job* done = nullptr;
+		for (Job* j = outbox.takeAll(); j;)
+		{
+			Job* next = j->next;
+			j->next = done;
+			done = j;
+			j = next;
+		}
+
+		int ran = 0;
+		for (Job* j = done; j;)
+		{
+			std::unique_ptr<Job> job(j);
+			j = j->next;
+
+			live.erase(job->result.ticket);
+			if (job->cancelled || !job->done) continue;
+			job->done(job->result);
+			ran++;
+		}
+		return ran;
+	}
+
+	//polls until nothing is pending, for loading screens and benchmarks
+	int drain()
+	{
+		int ran = 0;
+		while (!live.empty())
+		{
+			ran += poll();
+			if (!live.empty()) std::this_thread::yield();
+		}
+		return ran;
+	}
+};
+#endif//PATH_SERVICE_CLASS_H
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef PATH_SMOOTHING_H
+#define PATH_SMOOTHING_H
+
+#include "math/v3d.h"
+#include "Node.h"
+#include "TriangleBVH.h"
+
+#include <vector>
+
+//string pulling: keeps a waypoint only where skipping it would cut
+//through an obstacle. greedy, so one line of sight check per input
+//waypoint. the checks are thin segments, agents with a radius should
+//inflate the obstacle geometry they build the bvh from.
+//NavGraph::route runs this when RouteOptions::smooth is set.
+
+//pos(i) gives the position of the i-th waypoint, returns kept indices
+template<typename PosFn>
+std::vector<int> smoothPathIndices(int num, PosFn pos, const TriangleBVH& obstacles, int* los_checks = nullptr)
+{
+	std::vector<int> keep;
+	if (num <= 0) return keep;
+
+	keep.push_back(0);
+	int anchor = 0;
+	for (int k = 2; k < num; k++)
+	{
+		//k is always two or more past anchor, anchor -> k - 1 is either a
+		//graph edge or was checked already, so falling back to it is safe
+		if (los_checks) (*los_checks)++;
+		if (!obstacles.segmentBlocked(pos(anchor), pos(k))) continue;
+		anchor = k - 1;
+		keep.push_back(anchor);
+	}
+	if (num > 1) keep.push_back(num - 1);
+
+	return keep;
+}
+
+std::vector<Node*> smoothPath(const std::vector<Node*>& path, const TriangleBVH& obstacles, int* los_checks = nullptr)
+{
+	auto keep = smoothPathIndices(path.size(), [&](int i) { return path[i]->pos; }, obstacles, los_checks);
+
+	std::vector<Node*> result;
+	result.reserve(keep.size());
+	for (const auto& i : keep) result.push_back(path[i]);
+	return result;
+}
+#endif//PATH_SMOOTHING_H
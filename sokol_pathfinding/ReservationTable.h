@@ -0,0 +1,128 @@
+#pragma once
+#ifndef RESERVATION_TABLE_CLASS_H
+#define RESERVATION_TABLE_CLASS_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//space-time reservations for cooperative planning: which agent holds
+//node v at tick t, and which holds the link between a and b from t to t + 1
+//(either way, so two agents cant swap places through each other).
+//open addressing over one flat array, lookups touch a cache line or two
+//however many agents there are. entries are stamped like SearchContext,
+//so clear() is O(1) and a cleared table keeps its memory.
+class ReservationTable
+{
+	struct Entry
+	{
+		uint64_t key;
+		uint32_t tick;
+		int owner;
+		unsigned stamp;
+	};
+
+	std::vector<Entry> slots;
+	unsigned generation = 1;
+	int count = 0;
+
+	//nodes and node pairs in separate key spaces
+	static uint64_t nodeKey(int v) { return uint64_t(uint32_t(v)); }
+
+	static uint64_t linkKey(int a, int b)
+	{
+		if (a > b) std::swap(a, b);
+		return (uint64_t(1) << 63) | (uint64_t(uint32_t(a)) << 31) | uint32_t(b);
+	}
+
+	static uint64_t mix(uint64_t key, uint32_t tick)
+	{
+		uint64_t h = key ^ (uint64_t(tick) * 0x9e3779b97f4a7c15ull);
+		h ^= h >> 31;
+		h *= 0xbf58476d1ce4e5b9ull;
+		h ^= h >> 29;
+		return h;
+	}
+
+	bool live(const Entry& e) const { return e.stamp == generation; }
+
+	//slot holding key at tick, or the empty one it would go in
+	int find(uint64_t key, uint32_t tick) const
+	{
+		const int mask = slots.size() - 1;
+		for (int i = mix(key, tick) & mask;; i = (i + 1) & mask)
+		{
+			const Entry& e = slots[i];
+			if (!live(e) || (e.key == key && e.tick == tick)) return i;
+		}
+	}
+
+	void grow()
+	{
+		std::vector<Entry> old;
+		old.swap(slots);
+		slots.assign(old.empty() ? 1024 : old.size() * 2, Entry{ 0, 0, -1, 0 });
+		unsigned old_generation = generation;
+		generation = 1;
+		count = 0;
+		for (const auto& e : old)
+		{
+			if (e.stamp == old_generation) insert(e.key, e.tick, e.owner);
+		}
+	}
+
+	void insert(uint64_t key, uint32_t tick, int owner)
+	{
+		//half full at most, so probes stay short
+		if (2 * (count + 1) > (int)slots.size()) grow();
+		Entry& e = slots[find(key, tick)];
+		if (!live(e)) count++;
+		e = { key, tick, owner, generation };
+	}
+
+	int ownerOf(uint64_t key, uint32_t tick) const
+	{
+		if (slots.empty()) return -1;
+		const Entry& e = slots[find(key, tick)];
+		return live(e) ? e.owner : -1;
+	}
+
+public:
+	//drops every reservation, keeps the memory
+	void clear()
+	{
+		count = 0;
+		//on wrap around old stamps could look current again
+		if (++generation == 0)
+		{
+			for (auto& e : slots) e.stamp = 0;
+			generation = 1;
+		}
+	}
+
+	int size() const { return count; }
+
+	size_t memoryUsage() const { return slots.capacity() * sizeof(Entry); }
+
+	//later reservations of the same slot overwrite earlier ones
+	void reserveNode(int v, uint32_t tick, int owner) { insert(nodeKey(v), tick, owner); }
+	void reserveLink(int a, int b, uint32_t tick, int owner) { insert(linkKey(a, b), tick, owner); }
+
+	//-1 if nobody holds it
+	int nodeOwner(int v, uint32_t tick) const { return ownerOf(nodeKey(v), tick); }
+	int linkOwner(int a, int b, uint32_t tick) const { return ownerOf(linkKey(a, b), tick); }
+
+	//free, or held by agent itself
+	bool nodeFree(int v, uint32_t tick, int agent) const
+	{
+		int o = nodeOwner(v, tick);
+		return o < 0 || o == agent;
+	}
+
+	bool linkFree(int a, int b, uint32_t tick, int agent) const
+	{
+		int o = linkOwner(a, b, tick);
+		return o < 0 || o == agent;
+	}
+};
+#endif//RESERVATION_TABLE_CLASS_H
@@ -0,0 +1,108 @@
+#pragma once
+#ifndef SEARCH_CONTEXT_STRUCT_H
+#define SEARCH_CONTEXT_STRUCT_H
+
+#include "IndexedHeap.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+struct RouteStats
+{
+	int expanded = 0;
+	int los_checks = 0;
+};
+
+//per query scratch for searches over a NavGraph.
+//nothing is written into the graph, so any number of threads can search
+//the same graph as long as each has its own context.
+//values are only valid when their stamp equals the current generation,
+//so starting a query is O(1) instead of an O(N) reset.
+struct SearchContext
+{
+	std::vector<float> g_cost;
+	std::vector<int> parent;
+	std::vector<unsigned> seen, closed;
+	unsigned generation = 0;
+
+	IndexedHeap open;
+	RouteStats stats;
+
+	//focal search keeps the open list in two more orders, and the closed
+	//nodes it later found a cheaper way into in a third.
+	//not touched by begin(), the search sizes and clears them itself.
+	IndexedHeap open_f, waiting, incons;
+
+	std::unique_ptr<SearchContext> rev;
+
+	//call once per query. only grows, so a reused context stops allocating.
+	void begin(int num_nodes)
+	{
+		if ((int)seen.size() < num_nodes)
+		{
+			g_cost.resize(num_nodes);
+			parent.resize(num_nodes);
+			seen.resize(num_nodes, 0);
+			closed.resize(num_nodes, 0);
+		}
+		open.reserve(num_nodes);
+		open.clear();
+		stats = {};
+
+		//on wrap around old stamps could look current again
+		if (++generation == 0)
+		{
+			std::fill(seen.begin(), seen.end(), 0);
+			std::fill(closed.begin(), closed.end(), 0);
+			generation = 1;
+		}
+	}
+
+	bool isSeen(int i) const { return seen[i] == generation; }
+	bool isClosed(int i) const { return closed[i] == generation; }
+
+	float g(int i) const { return isSeen(i) ? g_cost[i] : INFINITY; }
+
+	void visit(int i, float g, int p)
+	{
+		seen[i] = generation;
+		g_cost[i] = g;
+		parent[i] = p;
+	}
+
+	void close(int i) { closed[i] = generation; }
+
+	//for searches that may find a cheaper way into a closed node
+	void reopen(int i) { closed[i] = 0; }
+
+	//from -> to, or empty if to was never reached
+	std::vector<int> tracePath(int to) const
+	{
+		std::vector<int> path;
+		if (!isSeen(to)) return path;
+		for (int curr = to; curr != -1; curr = parent[curr])
+		{
+			path.push_back(curr);
+		}
+		std::reverse(path.begin(), path.end());
+		return path;
+	}
+
+	//second set of state for searches that grow from both ends.
+	//created on first use and reused after that.
+	SearchContext& reverse()
+	{
+		if (!rev) rev = std::make_unique<SearchContext>();
+		return *rev;
+	}
+
+	//handy default for callers that dont manage their own
+	static SearchContext& local()
+	{
+		thread_local SearchContext ctx;
+		return ctx;
+	}
+};
+#endif//SEARCH_CONTEXT_STRUCT_H
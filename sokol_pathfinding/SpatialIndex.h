@@ -0,0 +1,261 @@
+#pragma once
+#ifndef SPATIAL_INDEX_CLASS_H
+#define SPATIAL_INDEX_CLASS_H
+
+#include "math/v3d.h"
+#include "Node.h"
+
+#include <cmath>
+#include <list>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+//uniform xz grid over node positions for nearest waypoint lookups.
+//waypoints sit on a terrain, so the grid is 2d and distances are full 3d.
+//cells are sized for ~2 nodes each, and keep positions next to the node
+//pointers so scans dont chase into the nodes themselves.
+//insert/remove are O(cell size), a node outside the grid triggers a rebuild.
+class SpatialIndex
+{
+	struct Item
+	{
+		cmn::vf3d pos;
+		Node* node;
+	};
+
+	float cell = 1;
+	float min_x = 0, min_z = 0;
+	int cols = 0, rows = 0;
+	int count = 0;
+
+	std::vector<std::vector<Item>> cells;
+
+	int cellX(float x) const { return std::min(cols - 1, std::max(0, int((x - min_x) / cell))); }
+	int cellZ(float z) const { return std::min(rows - 1, std::max(0, int((z - min_z) / cell))); }
+
+	bool inside(const cmn::vf3d& p) const
+	{
+		return cols > 0 && p.x >= min_x && p.z >= min_z && p.x < min_x + cols * cell && p.z < min_z + rows * cell;
+	}
+
+	//gathers everything and rebuilds around it
+	void rebuildWith(Node* extra)
+	{
+		std::vector<Node*> all;
+		all.reserve(count + 1);
+		for (const auto& c : cells)
+		{
+			for (const auto& it : c) all.push_back(it.node);
+		}
+		if (extra) all.push_back(extra);
+		build(all.begin(), all.end());
+	}
+
+	//lower bound on the xz distance from p to anything outside
+	//the square of cells within r rings of (cx, cz)
+	float ringBound(const cmn::vf3d& p, int cx, int cz, int r) const
+	{
+		float lo_x = p.x - (min_x + (cx - r) * cell);
+		float hi_x = min_x + (cx + r + 1) * cell - p.x;
+		float lo_z = p.z - (min_z + (cz - r) * cell);
+		float hi_z = min_z + (cz + r + 1) * cell - p.z;
+		return std::min(std::min(lo_x, hi_x), std::min(lo_z, hi_z));
+	}
+
+	//calls fn(item) for every item in ring r around (cx, cz)
+	template<typename F>
+	void scanRing(int cx, int cz, int r, F fn) const
+	{
+		int x0 = cx - r, x1 = cx + r, z0 = cz - r, z1 = cz + r;
+		for (int z = std::max(0, z0); z <= std::min(rows - 1, z1); z++)
+		{
+			bool edge_row = z == z0 || z == z1;
+			int step = edge_row ? 1 : x1 - x0;
+			for (int x = x0; x <= x1; x += step)
+			{
+				if (x < 0 || x >= cols) continue;
+				for (const auto& it : cells[x + cols * z]) fn(it);
+			}
+		}
+	}
+
+	//how many rings it takes to cover the whole grid from (cx, cz)
+	int maxRing(int cx, int cz) const
+	{
+		return std::max(std::max(cx, cols - 1 - cx), std::max(cz, rows - 1 - cz));
+	}
+
+public:
+	SpatialIndex() {}
+
+	int size() const { return count; }
+	float cellSize() const { return cell; }
+
+	size_t memoryUsage() const
+	{
+		size_t total = cells.capacity() * sizeof(std::vector<Item>);
+		for (const auto& c : cells) total += c.capacity() * sizeof(Item);
+		return total;
+	}
+
+	//any range of Node*
+	template<typename It>
+	void build(It begin, It end)
+	{
+		cells.clear();
+		count = 0;
+		cols = rows = 0;
+		if (begin == end) return;
+
+		float max_x = 0, max_z = 0;
+		int n = 0;
+		for (It it = begin; it != end; ++it, n++)
+		{
+			const auto& p = (*it)->pos;
+			if (n == 0 || p.x < min_x) min_x = p.x;
+			if (n == 0 || p.z < min_z) min_z = p.z;
+			if (n == 0 || p.x > max_x) max_x = p.x;
+			if (n == 0 || p.z > max_z) max_z = p.z;
+		}
+
+		//pad so nodes on the max edge land inside, and small moves dont rebuild
+		float w = std::max(max_x - min_x, 1e-3f), h = std::max(max_z - min_z, 1e-3f);
+		cell = std::max(std::sqrt(2 * w * h / n), 1e-3f);
+		min_x -= cell, min_z -= cell;
+		cols = 3 + int(w / cell), rows = 3 + int(h / cell);
+
+		cells.resize(cols * rows);
+		for (It it = begin; it != end; ++it) insert(*it);
+	}
+
+	static SpatialIndex make(const std::list<Node*>& nodes)
+	{
+		SpatialIndex s;
+		s.build(nodes.begin(), nodes.end());
+		return s;
+	}
+
+	void insert(Node* n)
+	{
+		if (!n) return;
+		if (!inside(n->pos))
+		{
+			rebuildWith(n);
+			return;
+		}
+		cells[cellX(n->pos.x) + cols * cellZ(n->pos.z)].push_back({ n->pos, n });
+		count++;
+	}
+
+	//uses the position the node was inserted with
+	bool remove(const Node* n)
+	{
+		if (!n || cols == 0) return false;
+		auto& c = cells[cellX(n->pos.x) + cols * cellZ(n->pos.z)];
+		for (auto& it : c)
+		{
+			if (it.node != n) continue;
+			it = c.back();
+			c.pop_back();
+			count--;
+			return true;
+		}
+		return false;
+	}
+
+	//for nodes moved by hand
+	void move(Node* n, const cmn::vf3d& old_pos)
+	{
+		cmn::vf3d new_pos = n->pos;
+		n->pos = old_pos;
+		bool had = remove(n);
+		n->pos = new_pos;
+		if (had) insert(n);
+	}
+
+	//closest node to p within max_dist, or nullptr
+	Node* nearest(const cmn::vf3d& p, float max_dist = INFINITY) const
+	{
+		if (count == 0) return nullptr;
+
+		const int cx = cellX(p.x), cz = cellZ(p.z);
+		float best = max_dist * max_dist;
+		Node* found = nullptr;
+		for (int r = 0, last = maxRing(cx, cz); r <= last; r++)
+		{
+			scanRing(cx, cz, r, [&](const Item& it) {
+				float d = (it.pos - p).mag2();
+				if (d < best) best = d, found = it.node;
+			});
+			float bound = ringBound(p, cx, cz, r);
+			if (bound > 0 && bound * bound >= best) break;
+		}
+		return found;
+	}
+
+	//up to k closest nodes within max_dist, nearest first
+	std::vector<Node*> kNearest(const cmn::vf3d& p, int k, float max_dist = INFINITY) const
+	{
+		std::vector<std::pair<float, Node*>> heap;
+		if (count == 0 || k <= 0) return {};
+		heap.reserve(k + 1);
+
+		const float limit = max_dist * max_dist;
+		const int cx = cellX(p.x), cz = cellZ(p.z);
+		for (int r = 0, last = maxRing(cx, cz); r <= last; r++)
+		{
+			scanRing(cx, cz, r, [&](const Item& it) {
+				float d = (it.pos - p).mag2();
+				if (d > limit) return;
+				if ((int)heap.size() < k)
+				{
+					heap.push_back({ d, it.node });
+					std::push_heap(heap.begin(), heap.end());
+				}
+				else if (d < heap.front().first)
+				{
+					std::pop_heap(heap.begin(), heap.end());
+					heap.back() = { d, it.node };
+					std::push_heap(heap.begin(), heap.end());
+				}
+			});
+			float worst = (int)heap.size() < k ? limit : heap.front().first;
+			float bound = ringBound(p, cx, cz, r);
+			if (bound > 0 && bound * bound >= worst) break;
+		}
+
+		std::sort_heap(heap.begin(), heap.end());
+		std::vector<Node*> result;
+		result.reserve(heap.size());
+		for (const auto& h : heap) result.push_back(h.second);
+		return result;
+	}
+
+	//every node within radius of p, in no particular order
+	void radius(const cmn::vf3d& p, float rad, std::vector<Node*>& out) const
+	{
+		if (count == 0 || rad < 0) return;
+		const float r2 = rad * rad;
+		int x0 = cellX(p.x - rad), x1 = cellX(p.x + rad);
+		int z0 = cellZ(p.z - rad), z1 = cellZ(p.z + rad);
+		for (int z = z0; z <= z1; z++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				for (const auto& it : cells[x + cols * z])
+				{
+					if ((it.pos - p).mag2() <= r2) out.push_back(it.node);
+				}
+			}
+		}
+	}
+
+	std::vector<Node*> radius(const cmn::vf3d& p, float rad) const
+	{
+		std::vector<Node*> out;
+		radius(p, rad, out);
+		return out;
+	}
+};
+#endif//SPATIAL_INDEX_CLASS_H
@@ -0,0 +1,167 @@
+#pragma once
+#ifndef THREAD_POOL_CLASS_H
+#define THREAD_POOL_CLASS_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//small work stealing pool.
+//each thread owns a deque, pops its own work from the back
+//and steals from the front of the others when it runs dry.
+//the thread calling parallelFor helps out instead of sleeping,
+//it gets the last queue slot.
+class ThreadPool
+{
+	typedef std::function<void(int)> Task;
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+	std::atomic<int> queued{ 0 };
+	bool stopping = false;
+
+	bool popOwn(int self, Task& task)
+	{
+		Queue& q = *queues[self];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (q.tasks.empty()) return false;
+		task = std::move(q.tasks.back());
+		q.tasks.pop_back();
+		return true;
+	}
+
+	bool steal(int self, Task& task)
+	{
+		int n = queues.size();
+		for (int k = 1; k < n; k++)
+		{
+			Queue& q = *queues[(self + k) % n];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (q.tasks.empty()) continue;
+			task = std::move(q.tasks.front());
+			q.tasks.pop_front();
+			return true;
+		}
+		return false;
+	}
+
+	//runs one task if there is any. worker index passed to the task.
+	bool runOne(int self)
+	{
+		Task task;
+		if (!popOwn(self, task) && !steal(self, task)) return false;
+		queued--;
+		task(self);
+		return true;
+	}
+
+	void workerLoop(int self)
+	{
+		for (;;)
+		{
+			if (runOne(self)) continue;
+
+			std::unique_lock<std::mutex> lock(wake_mutex);
+			wake.wait(lock, [&] { return stopping || queued > 0; });
+			if (stopping && queued == 0) return;
+		}
+	}
+
+public:
+	//num_threads counts the calling thread, so 1 means run inline.
+	ThreadPool(int num_threads = std::max(1u, std::thread::hardware_concurrency()))
+	{
+		num_threads = std::max(1, num_threads);
+		for (int i = 0; i < num_threads; i++)
+		{
+			queues.push_back(std::make_unique<Queue>());
+		}
+		for (int i = 0; i < num_threads - 1; i++)
+		{
+			workers.emplace_back(&ThreadPool::workerLoop, this, i);
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& w : workers) w.join();
+	}
+
+	//threads doing work, including the caller
+	int size() const { return queues.size(); }
+
+	//calls fn(i, worker) for every i in [0, count), worker in [0, size()).
+	//returns once all of them are done. one caller at a time, and not from inside fn.
+	template<typename F>
+	void parallelFor(int count, F&& fn, int grain = 0)
+	{
+		if (count <= 0) return;
+
+		const int n = size();
+		const int self = n - 1;
+		if (n == 1)
+		{
+			for (int i = 0; i < count; i++) fn(i, self);
+			return;
+		}
+
+		//a few chunks per thread so stealing can even things out
+		if (grain <= 0) grain = std::max(1, count / (8 * n));
+
+		std::atomic<int> remaining{ (count + grain - 1) / grain };
+		int slot = 0;
+		for (int s = 0; s < count; s += grain, slot = (slot + 1) % n)
+		{
+			int e = std::min(count, s + grain);
+			Queue& q = *queues[slot];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.tasks.emplace_back([&fn, &remaining, s, e](int worker) {
+				for (int i = s; i < e; i++) fn(i, worker);
+				remaining--;
+			});
+			queued++;
+		}
+
+		{
+			//pairs with the predicate check in workerLoop
+			std::lock_guard<std::mutex> lock(wake_mutex);
+		}
+		wake.notify_all();
+
+		while (remaining > 0)
+		{
+			if (!runOne(self)) std::this_thread::yield();
+		}
+	}
+
+	//one per process, sized to the machine
+	static ThreadPool& shared()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+};
+#endif//THREAD_POOL_CLASS_H
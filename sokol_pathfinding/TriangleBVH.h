@@ -0,0 +1,231 @@
+#pragma once
+#ifndef TRIANGLE_BVH_CLASS_H
+#define TRIANGLE_BVH_CLASS_H
+
+#include "math/v3d.h"
+
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+//bounding volume hierarchy over world space triangles.
+//answers "is this segment blocked" in ~log(tris) box tests instead of
+//a loop over every triangle of every mesh, which is what path smoothing
+//and any-angle searches need. add triangles, build() once, then query
+//from any number of threads.
+class TriangleBVH
+{
+	struct Box
+	{
+		cmn::vf3d min{ INFINITY, INFINITY, INFINITY }, max{ -INFINITY, -INFINITY, -INFINITY };
+
+		void fit(const cmn::vf3d& p)
+		{
+			min.x = std::min(min.x, p.x), min.y = std::min(min.y, p.y), min.z = std::min(min.z, p.z);
+			max.x = std::max(max.x, p.x), max.y = std::max(max.y, p.y), max.z = std::max(max.z, p.z);
+		}
+	};
+
+	struct Tri
+	{
+		cmn::vf3d a, b, c;
+	};
+
+	//leaf if count > 0, tris [first, first+count).
+	//inner nodes have their left child right after them, right child at first.
+	struct BVHNode
+	{
+		Box box;
+		int first = 0, count = 0;
+	};
+
+	std::vector<Tri> tris;
+	std::vector<BVHNode> nodes;
+
+	static const int leaf_size = 4;
+
+	static cmn::vf3d centroid(const Tri& t) { return (t.a + t.b + t.c) / 3; }
+
+	int buildNode(int first, int count)
+	{
+		int id = nodes.size();
+		nodes.push_back({});
+
+		Box box, centers;
+		for (int i = first; i < first + count; i++)
+		{
+			box.fit(tris[i].a), box.fit(tris[i].b), box.fit(tris[i].c);
+			centers.fit(centroid(tris[i]));
+		}
+		nodes[id].box = box;
+
+		cmn::vf3d ext = centers.max - centers.min;
+		int axis = ext.x > ext.y && ext.x > ext.z ? 0 : ext.y > ext.z ? 1 : 2;
+		if (count <= leaf_size || ext[axis] <= 0)
+		{
+			nodes[id].first = first;
+			nodes[id].count = count;
+			return id;
+		}
+
+		//median split keeps the tree balanced whatever the mesh looks like
+		int mid = first + count / 2;
+		std::nth_element(tris.begin() + first, tris.begin() + mid, tris.begin() + first + count,
+			[axis](const Tri& a, const Tri& b) { return centroid(a)[axis] < centroid(b)[axis]; });
+
+		buildNode(first, mid - first);
+		int right = buildNode(mid, first + count - mid);
+		nodes[id].first = right;
+		return id;
+	}
+
+	//slab test against the segment orig + t * dir, t in [0, t_max]
+	static bool hitsBox(const Box& b, const cmn::vf3d& orig, const cmn::vf3d& inv_dir, float t_max)
+	{
+		float t0 = 0, t1 = t_max;
+		for (int k = 0; k < 3; k++)
+		{
+			float lo = (b.min[k] - orig[k]) * inv_dir[k];
+			float hi = (b.max[k] - orig[k]) * inv_dir[k];
+			if (lo > hi) std::swap(lo, hi);
+			//nan when the segment lies in a slab plane, treat as overlapping
+			if (lo > t0) t0 = lo;
+			if (hi < t1) t1 = hi;
+			if (t0 > t1) return false;
+		}
+		return true;
+	}
+
+	//moller trumbore, t along dir or -1
+	static float hitTri(const Tri& tri, const cmn::vf3d& orig, const cmn::vf3d& dir)
+	{
+		const float epsilon = 1e-7f;
+		cmn::vf3d e1 = tri.b - tri.a, e2 = tri.c - tri.a;
+		cmn::vf3d p = dir.cross(e2);
+		float det = e1.dot(p);
+		if (std::abs(det) < epsilon) return -1;
+
+		float inv = 1 / det;
+		cmn::vf3d s = orig - tri.a;
+		float u = s.dot(p) * inv;
+		if (u < 0 || u > 1) return -1;
+
+		cmn::vf3d q = s.cross(e1);
+		float v = dir.dot(q) * inv;
+		if (v < 0 || u + v > 1) return -1;
+
+		return e2.dot(q) * inv;
+	}
+
+	//nearest hit with t in (t_min, t_max), or stops at the first if any_hit
+	float trace(const cmn::vf3d& orig, const cmn::vf3d& dir, float t_min, float t_max, bool any_hit) const
+	{
+		if (nodes.empty()) return -1;
+
+		cmn::vf3d inv_dir(1 / dir.x, 1 / dir.y, 1 / dir.z);
+		float best = -1;
+
+		int stack[64];
+		int top = 0;
+		stack[top++] = 0;
+		while (top)
+		{
+			const BVHNode& n = nodes[stack[--top]];
+			if (!hitsBox(n.box, orig, inv_dir, best < 0 ? t_max : best)) continue;
+
+			if (n.count)
+			{
+				for (int i = n.first; i < n.first + n.count; i++)
+				{
+					float t = hitTri(tris[i], orig, dir);
+					if (t <= t_min || t >= t_max || (best >= 0 && t >= best)) continue;
+					best = t;
+					if (any_hit) return best;
+				}
+				continue;
+			}
+
+			int id = &n - nodes.data();
+			stack[top++] = n.first;
+			stack[top++] = id + 1;
+		}
+		return best;
+	}
+
+public:
+	TriangleBVH() {}
+
+	int numTriangles() const { return tris.size(); }
+	int numNodes() const { return nodes.size(); }
+
+	size_t memoryUsage() const
+	{
+		return tris.capacity() * sizeof(Tri) + nodes.capacity() * sizeof(BVHNode);
+	}
+
+	//adding after build() needs another build()
+	void addTriangle(const cmn::vf3d& a, const cmn::vf3d& b, const cmn::vf3d& c)
+	{
+		tris.push_back({ a, b, c });
+	}
+
+	//axis aligned box as 12 triangles
+	void addBox(const cmn::vf3d& lo, const cmn::vf3d& hi)
+	{
+		cmn::vf3d v[8];
+		for (int i = 0; i < 8; i++)
+		{
+			v[i] = { i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z };
+		}
+		const int faces[6][4]{ { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 } };
+		for (const auto& f : faces)
+		{
+			addTriangle(v[f[0]], v[f[1]], v[f[2]]);
+			addTriangle(v[f[0]], v[f[2]], v[f[3]]);
+		}
+	}
+
+	void clear()
+	{
+		tris.clear();
+		nodes.clear();
+	}
+
+	void build()
+	{
+		nodes.clear();
+		if (tris.empty()) return;
+		nodes.reserve(2 * tris.size() / leaf_size + 1);
+		buildNode(0, tris.size());
+	}
+
+	//single leaf holding everything, a brute force baseline for benchmarks
+	void buildFlat()
+	{
+		nodes.clear();
+		if (tris.empty()) return;
+		BVHNode root;
+		for (const auto& t : tris) root.box.fit(t.a), root.box.fit(t.b), root.box.fit(t.c);
+		root.count = tris.size();
+		nodes.push_back(root);
+	}
+
+	//true if anything lies strictly between a and b
+	bool segmentBlocked(const cmn::vf3d& a, const cmn::vf3d& b) const
+	{
+		cmn::vf3d d = b - a;
+		if (d.mag2() == 0) return false;
+		//ignore touches right at the ends, waypoints may sit on a surface
+		return trace(a, d, 1e-4f, 1 - 1e-4f, true) >= 0;
+	}
+
+	//distance along dir (any length) to the nearest hit, -1 if none
+	float raycast(const cmn::vf3d& orig, const cmn::vf3d& dir, float max_dist = INFINITY) const
+	{
+		float len = dir.mag();
+		if (len == 0) return -1;
+		return trace(orig, dir / len, 0, max_dist, false);
+	}
+};
+#endif//TRIANGLE_BVH_CLASS_H
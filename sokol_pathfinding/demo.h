@@ -16,6 +16,10 @@
 #include "AABB.h"
 #include "poisson_disc.h"
 #include "Graph.h"
+#include "PathRequest.h"
+#include "PathService.h"
+#include "AgentSystem.h"
+#include "route_bench.h"
 #include "Triangulate.h"
 
 //for time
@@ -54,6 +58,8 @@ struct Demo : SokolEngine {
 	sg_pipeline terrain_pip{};
 	
 	Graph graph;
+	//everything but the terrain, for line of sight checks
+	TriangleBVH obstacles;
 	sg_sampler sampler{};
 	bool render_outlines = false;
 
@@ -71,6 +77,28 @@ struct Demo : SokolEngine {
 		"assets/models/tatooinehouse1.txt",
 	};
 
+	const std::string navgraph_filename = "assets/navgraph.bin";
+
+	//path query spread over frames, at most this much search per frame
+	PathRequest path_request;
+	const int path_budget_expansions = 2000;
+	const float path_budget_us = 2000;
+
+	//routes searched off the main thread, results picked up next frame
+	PathService path_service;
+	int service_found = 0, service_missed = 0;
+
+	//walkers roaming between random waypoints, routes come from path_service
+	AgentSystem agents;
+	const int num_agents = 2000;
+	//node each agent is headed for, where its next route starts
+	std::vector<int> agent_goal;
+	//empty routes in a row per agent, past the limit it stands still
+	std::vector<int> agent_misses;
+	const int max_route_misses = 4;
+	//a short upright line per agent, vertexes streamed every frame
+	LineMesh agent_lines;
+
 	const std::vector<std::string> texturefilenames
 	{
 		"assets/poust_1.png",
@@ -187,7 +215,8 @@ struct Demo : SokolEngine {
 	
 	}
 
-	void setupNodes()
+	//sample, project, triangulate and prune a fresh graph. slow on big maps.
+	void generateNodes()
 	{
 		//randomly sample points on xz plane
 		Object terrian = objects[0];
@@ -202,8 +231,7 @@ struct Demo : SokolEngine {
 			cmn::vf3d orig(p.x, bounds.min.y - .1f, p.y);
 			cmn::vf3d dir(0, 1, 0);
 			float dist = terrian.intersectRay(orig,dir);
-			graph.nodes.push_back(new Node(orig + (.2f + dist) * dir));
-			xz2way[&p] = graph.nodes.back();
+			xz2way[&p] = graph.addNode(orig + (.2f + dist) * dir);
 
 		}
 
@@ -220,40 +248,57 @@ struct Demo : SokolEngine {
 		}
 
 		//remove any nodes in way of obstacle
-		for (auto it = graph.nodes.begin(); it != graph.nodes.end();)
+		std::vector<Node*> blocked_nodes;
+		for (const auto& n : graph.nodes)
 		{
-			auto& n = *it;
 			//check if inside any meshes
-			bool blocked = false;
 			for (int i = 1; i < objects.size(); i++)
 			{
 				if (objects[i].contains(n->pos))
 				{
-					blocked = true;
+					blocked_nodes.push_back(n);
 					break;
 				}
 			}
+		}
 
-			if (blocked)
-			{
-				for (auto& o : graph.nodes)
-				{
-					auto oit = std::find(o->links.begin(), o->links.end(), n);
-					if (oit != o->links.end()) o->links.erase(oit);
-				}
-
-				delete n;
-				it = graph.nodes.erase(it);
+		for (const auto& n : blocked_nodes)
+		{
+			graph.removeNode(n);
+		}
+	}
 
-			}
-			else
-			{
-				it++;
-			}
+	void setupNodes()
+	{
+		//reuse the graph from an earlier launch if there is one.
+		//delete the file after changing the level to regenerate it.
+		//sampled nodes come out scattered, number them along a hilbert
+		//curve so neighbors sit close in memory. saved files keep it.
+		graph.setNodeOrder(ORDER_HILBERT);
+		auto status = graph.load(navgraph_filename);
+		if (!status.valid)
+		{
+			generateNodes();
+			//not fatal, just regenerates next launch too
+			status = graph.save(navgraph_filename);
+		}
 
+		//RouteOptions::obstacles, for smoothing and Theta*
+		obstacles.clear();
+		for (int i = 1; i < objects.size(); i++)
+		{
+			objects[i].addTrianglesTo(obstacles);
 		}
+		obstacles.build();
 
+		//climbing the dunes costs extra, too steep to walk is cut
+		SlopeCost slope;
+		slope.max_grade = 1.5f;
+		graph.setCostPolicy(slope);
 
+		//build the search structures up front instead of on the first query
+		graph.freeze();
+		graph.spatialIndex();
 	}
 
 	void setupPlatform() {
@@ -294,6 +339,35 @@ struct Demo : SokolEngine {
 	
 	}
 
+	void setupAgents()
+	{
+		auto nav = graph.snapshot();
+		if (nav->size() == 0) return;
+
+		agents.clear();
+		agent_goal.clear();
+		agent_misses.clear();
+		for (int i = 0; i < num_agents; i++)
+		{
+			int at = xorshift32() % nav->size();
+			agents.addAgent(nav->pos[at], 1 + randFloat(2));
+			agent_goal.push_back(at);
+			agent_misses.push_back(0);
+			requestAgentRoute(i);
+		}
+
+		//two verts per agent, the lines never change
+		agent_lines.verts.assign(2 * num_agents, { {}, { 1, .8f, .2f, 1 } });
+		agent_lines.lines.resize(num_agents);
+		for (int i = 0; i < num_agents; i++)
+		{
+			agent_lines.lines[i].a = 2 * i;
+			agent_lines.lines[i].b = 2 * i + 1;
+		}
+		agent_lines.updateIndexBuffer();
+		agent_lines.makeStreamVertexBuffer();
+	}
+
 	void setupNodeBillboards()
 	{
 		int count = 0;
@@ -372,6 +446,8 @@ struct Demo : SokolEngine {
 
 
 		setupBillboard();
+
+		setupAgents();
 		
 
 		
@@ -428,6 +504,12 @@ struct Demo : SokolEngine {
 		if (getKey(SAPP_KEYCODE_R).held) mainlight->pos = cam.pos;
 		//toggle shape outlines
 		if (getKey(SAPP_KEYCODE_O).pressed) render_outlines ^= true;
+		//print route timings for the current graph
+		if (getKey(SAPP_KEYCODE_B).pressed) bench::runRouteBenchmark(graph);
+		//route from the camera to a random waypoint, a slice per frame
+		if (getKey(SAPP_KEYCODE_P).pressed) startPathRequest();
+		//a burst of background routes, the nearer ones first
+		if (getKey(SAPP_KEYCODE_N).pressed) submitRouteBurst(64);
 
 		handleCameraMovement(dt);
 	}
@@ -504,6 +586,83 @@ struct Demo : SokolEngine {
 	
 	
 
+	//route from where agent i is headed to somewhere reachable from there
+	void requestAgentRoute(int i)
+	{
+		auto nav = graph.snapshot();
+		int from = agent_goal[i], to = from;
+		for (int tries = 0; tries < 8 && (to == from || !nav->connected(from, to)); tries++)
+		{
+			to = xorshift32() % nav->size();
+		}
+		path_service.submit(nav, from, to, [this, i](const PathResult& res) {
+			if (!res.found())
+			{
+				//likely cut off from everything, park it instead of asking forever
+				if (++agent_misses[i] < max_route_misses) requestAgentRoute(i);
+				else agents.setPath(i, -1);
+				return;
+			}
+			agent_misses[i] = 0;
+			agents.setPath(i, agents.addPath(*res.nav, res.path));
+			agent_goal[i] = res.to;
+		});
+	}
+
+	//everyone along their paths, new routes for whoever got to the end
+	void updateAgents(float dt)
+	{
+		agents.update(dt);
+		for (const auto& i : agents.justArrived()) requestAgentRoute(i);
+	}
+
+	void startPathRequest()
+	{
+		if (graph.nodes.empty()) return;
+		auto it = graph.nodes.begin();
+		std::advance(it, xorshift32() % graph.nodes.size());
+		path_request.start(graph.snapshot(), graph.nearestNode(cam.pos), *it);
+	}
+
+	void submitRouteBurst(int num)
+	{
+		if (graph.nodes.empty()) return;
+		std::vector<Node*> all(graph.nodes.begin(), graph.nodes.end());
+		auto nav = graph.snapshot();
+		Node* from = graph.nearestNode(cam.pos);
+		for (int i = 0; i < num; i++)
+		{
+			Node* to = all[xorshift32() % all.size()];
+			//closer targets matter more, bucketed by distance
+			int priority = -int((to->pos - cam.pos).mag());
+			path_service.submit(nav, from, to, [this](const PathResult& res) {
+				if (res.found()) service_found++;
+				else service_missed++;
+			}, priority);
+		}
+	}
+
+	//callbacks run here, on the main thread
+	void collectRoutes()
+	{
+		if (path_service.poll() == 0 || path_service.pending()) return;
+		//agent routes dont count
+		if (service_found + service_missed == 0) return;
+		std::printf("path service: %d found, %d without a path\n", service_found, service_missed);
+		service_found = service_missed = 0;
+	}
+
+	void updatePathRequest()
+	{
+		if (path_request.done()) return;
+		path_request.step(path_budget_expansions, path_budget_us);
+		if (!path_request.done()) return;
+
+		std::printf("path request: %s, %zu waypoints, %d expanded over %d frames, %.1f us total\n",
+			path_request.found() ? "found" : "no path", path_request.result().size(),
+			path_request.stats().expanded, path_request.numSlices(), path_request.elapsedUs());
+	}
+
 #pragma endregion
 
 	void updateCameraMatrixes() {
@@ -519,11 +678,17 @@ struct Demo : SokolEngine {
 
 
 	void userUpdate(float dt) {
-		
+		//results from last frame's requests
+		collectRoutes();
+
 		handleUserInput(dt);
 	
 		updateCameraMatrixes();
 
+		updatePathRequest();
+
+		updateAgents(dt);
+
 		for (auto& obj : objects)
 		{
 			if (obj.isbillboard)
@@ -628,6 +793,32 @@ struct Demo : SokolEngine {
 		sg_draw(0, 3* obj.mesh.tris.size(), 1);
 	}
 
+	void renderAgents()
+	{
+		if (agents.size() == 0) return;
+		for (int i = 0; i < agents.size(); i++)
+		{
+			cmn::vf3d p = agents.position(i);
+			agent_lines.verts[2 * i].pos = p;
+			agent_lines.verts[2 * i + 1].pos = p + cmn::vf3d(0, .5f, 0);
+		}
+		agent_lines.streamVertexBuffer();
+
+		sg_apply_pipeline(line_pip);
+
+		sg_bindings bind{};
+		bind.vertex_buffers[0] = agent_lines.vbuf;
+		bind.index_buffer = agent_lines.ibuf;
+		sg_apply_bindings(bind);
+
+		//positions are in world space already
+		vs_line_params_t vs_line_params{};
+		std::memcpy(vs_line_params.u_mvp, cam.view_proj.m, sizeof(vs_line_params.u_mvp));
+		sg_apply_uniforms(UB_vs_line_params, SG_RANGE(vs_line_params));
+
+		sg_draw(0, 2 * agent_lines.lines.size(), 1);
+	}
+
 	void renderObjectOutlines(const Object& obj)
 	{
 	
@@ -695,6 +886,8 @@ struct Demo : SokolEngine {
 		{
 			renderObjects(obj);
 		}
+
+		renderAgents();
 		
 		sg_end_pass();
 		
@@ -50,6 +50,24 @@ struct LineMesh {
 		vbuf = sg_make_buffer(vbuf_desc);
 	}
 
+	//for verts that move every frame: made once with room for all of them,
+	//then only written through streamVertexBuffer, at most once a frame.
+	void makeStreamVertexBuffer() {
+		//free old
+		if (vbuf.id != SG_INVALID_ID) sg_destroy_buffer(vbuf);
+
+		sg_buffer_desc vbuf_desc{};
+		vbuf_desc.usage.vertex_buffer = true;
+		vbuf_desc.usage.stream_update = true;
+		vbuf_desc.size = sizeof(Vertex) * verts.size();
+		vbuf = sg_make_buffer(vbuf_desc);
+	}
+
+	void streamVertexBuffer() {
+		sg_range data{ verts.data(), sizeof(Vertex) * verts.size() };
+		sg_update_buffer(vbuf, &data);
+	}
+
 	void updateIndexBuffer() {
 		//free old
 		if (ibuf.id != SG_INVALID_ID) sg_destroy_buffer(ibuf);
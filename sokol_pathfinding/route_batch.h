@@ -0,0 +1,79 @@
+#pragma once
+#ifndef ROUTE_BATCH_H
+#define ROUTE_BATCH_H
+
+#include "Graph.h"
+#include "NavGraph.h"
+#include "ThreadPool.h"
+
+#include <utility>
+#include <vector>
+
+//answers many (from, to) queries at once, spread over a ThreadPool.
+//results come back in input order. each worker searches with its own
+//thread_local SearchContext, the graph is shared read only.
+//no sokol in here, so it works headless too.
+
+std::vector<std::vector<int>> routeBatch(const NavGraph& nav,
+	const std::pair<int, int>* queries, int num_queries,
+	ThreadPool& pool = ThreadPool::shared(), RouteStats* total = nullptr,
+	const RouteOptions& opts = {})
+{
+	std::vector<std::vector<int>> results(num_queries);
+	std::vector<RouteStats> per_worker(pool.size());
+
+	pool.parallelFor(num_queries, [&](int i, int worker) {
+		SearchContext& ctx = SearchContext::local();
+		results[i] = nav.route(queries[i].first, queries[i].second, ctx, opts);
+		per_worker[worker].expanded += ctx.stats.expanded;
+		per_worker[worker].los_checks += ctx.stats.los_checks;
+	});
+
+	if (total)
+	{
+		*total = {};
+		for (const auto& s : per_worker)
+		{
+			total->expanded += s.expanded;
+			total->los_checks += s.los_checks;
+		}
+	}
+
+	return results;
+}
+
+std::vector<std::vector<int>> routeBatch(const NavGraph& nav,
+	const std::vector<std::pair<int, int>>& queries,
+	ThreadPool& pool = ThreadPool::shared(), RouteStats* total = nullptr,
+	const RouteOptions& opts = {})
+{
+	return routeBatch(nav, queries.data(), queries.size(), pool, total, opts);
+}
+
+//node flavored version. unknown nodes give an empty path.
+std::vector<std::vector<Node*>> routeBatch(const Graph& graph,
+	const std::vector<std::pair<Node*, Node*>>& queries,
+	ThreadPool& pool = ThreadPool::shared(), RouteStats* total = nullptr,
+	const RouteOptions& opts = {})
+{
+	const NavGraph& nav = graph.freeze();
+
+	std::vector<std::pair<int, int>> idx;
+	idx.reserve(queries.size());
+	for (const auto& q : queries)
+	{
+		idx.push_back({ nav.indexOf(q.first), nav.indexOf(q.second) });
+	}
+
+	auto found = routeBatch(nav, idx, pool, total, opts);
+
+	std::vector<std::vector<Node*>> results(found.size());
+	for (int i = 0; i < (int)found.size(); i++)
+	{
+		results[i].reserve(found[i].size());
+		for (const auto& n : found[i]) results[i].push_back(nav.nodes[n]);
+	}
+
+	return results;
+}
+#endif//ROUTE_BATCH_H
@@ -0,0 +1,1466 @@
+#pragma once
+#ifndef ROUTE_BENCH_H
+#define ROUTE_BENCH_H
+
+#include "math/v3d.h"
+#include "Graph.h"
+#include "route_batch.h"
+#include "ContractionHierarchy.h"
+#include "HierarchicalGraph.h"
+#include "PathCache.h"
+#include "DStarLite.h"
+#include "FlowField.h"
+#include "TriangleBVH.h"
+#include "NavGraphFile.h"
+#include "PathRequest.h"
+#include "PathService.h"
+#include "DistanceTable.h"
+#include "CooperativePlanner.h"
+#include "AgentSystem.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//headless route benchmarks. nothing in here touches sokol,
+//so it runs from the demo (B key) or any plain main().
+namespace bench
+{
+	struct Rng
+	{
+		uint32_t x;
+
+		Rng(uint32_t seed) : x(seed ? seed : 0x12345678) {}
+
+		uint32_t next()
+		{
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			return x;
+		}
+
+		int nextInt(int n) { return next() % n; }
+
+		float nextFloat() { return (next() & 0xffffff) / float(0x1000000); }
+	};
+
+	struct Timer
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		double ms() const
+		{
+			auto now = std::chrono::high_resolution_clock::now();
+			return std::chrono::duration<double, std::milli>(now - start).count();
+		}
+	};
+
+	//jittered 8-connected w x h grid on the xz plane,
+	//with random rectangular "buildings" carved out so A* has to go around.
+	//buildings, if given, gets a box per building for line of sight checks.
+	void makeGridGraph(Graph& g, int w, int h, float block_frac = .15f, uint32_t seed = 1, TriangleBVH* buildings = nullptr)
+	{
+		Rng rng(seed);
+
+		std::vector<bool> blocked(w * h, false);
+		int target = block_frac * w * h;
+		for (int num = 0; num < target;)
+		{
+			int bw = 2 + rng.nextInt(std::max(1, w / 16));
+			int bh = 2 + rng.nextInt(std::max(1, h / 16));
+			int bx = rng.nextInt(w), by = rng.nextInt(h);
+			if (buildings)
+			{
+				buildings->addBox({ bx - .5f, -1, by - .5f }, { std::min(w, bx + bw) - .5f, 1, std::min(h, by + bh) - .5f });
+			}
+			for (int i = bx; i < std::min(w, bx + bw); i++)
+			{
+				for (int j = by; j < std::min(h, by + bh); j++)
+				{
+					if (!blocked[i + w * j]) num++;
+					blocked[i + w * j] = true;
+				}
+			}
+		}
+
+		std::vector<Node*> grid(w * h, nullptr);
+		for (int j = 0; j < h; j++)
+		{
+			for (int i = 0; i < w; i++)
+			{
+				if (blocked[i + w * j]) continue;
+				float jx = .3f * (rng.nextFloat() - .5f);
+				float jz = .3f * (rng.nextFloat() - .5f);
+				grid[i + w * j] = g.addNode(cmn::vf3d(i + jx, 0, j + jz));
+			}
+		}
+
+		const int di[4]{ 1, 0, 1, 1 };
+		const int dj[4]{ 0, 1, 1, -1 };
+		for (int j = 0; j < h; j++)
+		{
+			for (int i = 0; i < w; i++)
+			{
+				Node* a = grid[i + w * j];
+				if (!a) continue;
+				for (int d = 0; d < 4; d++)
+				{
+					int ni = i + di[d], nj = j + dj[d];
+					if (ni < 0 || nj < 0 || ni >= w || nj >= h) continue;
+					Node* b = grid[ni + w * nj];
+					if (!b) continue;
+
+					//skip the containment scan in addLink, we know both are ours
+					a->links.push_back(b);
+					b->links.push_back(a);
+				}
+			}
+		}
+		g.markDirty();
+		if (buildings) buildings->build();
+	}
+
+	std::vector<std::pair<Node*, Node*>> makeQueries(const Graph& g, int num, uint32_t seed = 7)
+	{
+		std::vector<Node*> all(g.nodes.begin(), g.nodes.end());
+		std::vector<std::pair<Node*, Node*>> queries;
+		if (all.size() < 2) return queries;
+
+		Rng rng(seed);
+		for (int i = 0; i < num; i++)
+		{
+			queries.push_back({ all[rng.nextInt(all.size())], all[rng.nextInt(all.size())] });
+		}
+		return queries;
+	}
+
+	struct RouteBenchResult
+	{
+		int queries = 0;
+		int found = 0;
+		long long expanded = 0;
+		double ms = 0;
+		double cost = 0;
+
+		double expansionsPerSec() const { return ms > 0 ? 1000 * expanded / ms : 0; }
+		double usPerQuery() const { return queries ? 1000 * ms / queries : 0; }
+	};
+
+	void print(const char* label, const RouteBenchResult& r)
+	{
+		std::printf("%-24s %6d queries %6d found %10lld expanded %9.2f ms %9.1f us/query %12.0f exp/s %12.1f cost\n",
+			label, r.queries, r.found, r.expanded, r.ms, r.usPerQuery(), r.expansionsPerSec(), r.cost);
+	}
+
+	float pathCost(const std::vector<Node*>& path)
+	{
+		float cost = 0;
+		for (int i = 1; i < (int)path.size(); i++)
+		{
+			cost += (path[i]->pos - path[i - 1]->pos).mag();
+		}
+		return cost;
+	}
+
+	RouteBenchResult benchRoute(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries, const RouteOptions& opts = {})
+	{
+		RouteBenchResult r;
+		std::vector<std::vector<Node*>> paths;
+		paths.reserve(queries.size());
+		Timer t;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			paths.push_back(g.route(q.first, q.second, &stats, opts));
+			r.queries++;
+			r.expanded += stats.expanded;
+			if (paths.back().size()) r.found++;
+		}
+		r.ms = t.ms();
+		for (const auto& p : paths) r.cost += pathCost(p);
+		return r;
+	}
+
+	//same queries through routeBatch, for 1, 2, 4.. threads up to the core count.
+	void benchBatchScaling(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries)
+	{
+		const NavGraph& nav = g.freeze();
+		std::vector<std::pair<int, int>> idx;
+		for (const auto& q : queries) idx.push_back({ nav.indexOf(q.first), nav.indexOf(q.second) });
+
+		int max_threads = std::max(1u, std::thread::hardware_concurrency());
+		double base_ms = 0;
+		for (int t = 1;; t = std::min(2 * t, max_threads))
+		{
+			ThreadPool pool(t);
+			RouteBenchResult r;
+			RouteStats total;
+			Timer timer;
+			auto results = routeBatch(nav, idx, pool, &total);
+			r.ms = timer.ms();
+			r.queries = results.size();
+			r.expanded = total.expanded;
+			for (const auto& p : results)
+			{
+				if (p.size()) r.found++;
+				for (int i = 1; i < (int)p.size(); i++) r.cost += (nav.pos[p[i]] - nav.pos[p[i - 1]]).mag();
+			}
+			if (t == 1) base_ms = r.ms;
+
+			char label[64];
+			std::snprintf(label, sizeof(label), "batch %2d threads x%.2f", t, r.ms > 0 ? base_ms / r.ms : 0);
+			print(label, r);
+
+			if (t == max_threads) break;
+		}
+	}
+
+	//preprocessing cost, memory on top of the csr graph, then the same
+	//queries as plain A* and through the hierarchy.
+	void benchContraction(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries)
+	{
+		RouteBenchResult exact;
+		Timer et;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			auto path = g.route(q.first, q.second, &stats);
+			exact.queries++;
+			exact.expanded += stats.expanded;
+			if (path.size()) exact.found++;
+			exact.cost += pathCost(path);
+		}
+		exact.ms = et.ms();
+		print("A* baseline", exact);
+
+		const NavGraph& nav = g.freeze();
+		ContractionHierarchy::BuildStats build;
+		auto ch = ContractionHierarchy::build(nav, &build);
+		std::printf("contraction hierarchy: %9.2f ms build, %d shortcuts, %zu KB (+%.0f%% over csr)\n",
+			build.ms, build.shortcuts, ch.memoryUsage() / 1024, 100.0 * ch.memoryUsage() / nav.memoryUsage());
+
+		RouteBenchResult r;
+		std::vector<std::vector<Node*>> paths;
+		paths.reserve(queries.size());
+		Timer t;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			paths.push_back(ch.route(q.first, q.second, &stats));
+			r.queries++;
+			r.expanded += stats.expanded;
+			if (paths.back().size()) r.found++;
+		}
+		r.ms = t.ms();
+		for (const auto& p : paths) r.cost += pathCost(p);
+		print("CH query", r);
+		std::printf("%-24s %.2fx faster than A*\n", "", r.ms > 0 ? exact.ms / r.ms : 0);
+	}
+
+	//cluster_size in world units, the grid graph has one node per unit.
+	//plain A* on the same queries first, to weigh speed against path length.
+	void benchHierarchical(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries, float cluster_size = 16)
+	{
+		std::vector<float> optimal;
+		RouteBenchResult exact;
+		Timer et;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			auto path = g.route(q.first, q.second, &stats);
+			exact.queries++;
+			exact.expanded += stats.expanded;
+			if (path.size()) exact.found++;
+			optimal.push_back(pathCost(path));
+		}
+		exact.ms = et.ms();
+		for (const auto& c : optimal) exact.cost += c;
+		print("A* baseline", exact);
+
+		const NavGraph& nav = g.freeze();
+		Timer build;
+		auto h = HierarchicalGraph::build(nav, cluster_size);
+		std::printf("hierarchy: %9.2f ms build, %d clusters, %d entrances, %zu KB\n",
+			build.ms(), h.numClusters(), h.numEntrances(), h.memoryUsage() / 1024);
+
+		RouteBenchResult r;
+		std::vector<std::vector<Node*>> paths;
+		paths.reserve(queries.size());
+		Timer t;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			paths.push_back(h.route(q.first, q.second, &stats));
+			r.queries++;
+			r.expanded += stats.expanded;
+			if (paths.back().size()) r.found++;
+		}
+		r.ms = t.ms();
+
+		double ratio_sum = 0, worst = 1;
+		int counted = 0;
+		for (int i = 0; i < (int)paths.size(); i++)
+		{
+			float cost = pathCost(paths[i]);
+			r.cost += cost;
+			if (optimal[i] <= 0 || cost <= 0) continue;
+			ratio_sum += cost / optimal[i];
+			worst = std::max(worst, double(cost / optimal[i]));
+			counted++;
+		}
+		print("HPA*", r);
+		std::printf("%-24s %.2fx faster than A*, cost ratio %.4f mean %.4f worst\n", "",
+			r.ms > 0 ? exact.ms / r.ms : 0, counted ? ratio_sum / counted : 1, worst);
+	}
+
+	//agents tend to ask for the same few routes, so queries are drawn
+	//from a small set of popular pairs with a skew towards the first ones.
+	void benchPathCache(const Graph& g, int num_queries = 2000, int num_popular = 64, size_t capacity = 32)
+	{
+		auto popular = makeQueries(g, num_popular, 11);
+		if (popular.empty()) return;
+
+		std::vector<std::pair<Node*, Node*>> queries;
+		Rng rng(5);
+		for (int i = 0; i < num_queries; i++)
+		{
+			//min of two uniform picks leans towards low indices
+			int a = rng.nextInt(popular.size()), b = rng.nextInt(popular.size());
+			queries.push_back(popular[std::min(a, b)]);
+		}
+
+		PathCache cache(capacity);
+		RouteBenchResult r;
+		Timer t;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			auto path = cache.route(g, q.first, q.second, &stats);
+			r.queries++;
+			r.expanded += stats.expanded;
+			if (path.size()) r.found++;
+			r.cost += pathCost(path);
+		}
+		r.ms = t.ms();
+
+		char label[64];
+		std::snprintf(label, sizeof(label), "cached A* (%zu entries)", capacity);
+		print(label, r);
+
+		auto s = cache.stats();
+		std::printf("path cache: %zu hits %zu misses (%.1f%%), %zu evictions\n",
+			s.hits, s.misses, 100 * s.hitRate(), s.evictions);
+	}
+
+	//agents walk their routes while obstacles drop onto the path just
+	//ahead of them. compares D* Lite repairs against planning from scratch.
+	void benchIncremental(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries, int num_agents = 16, int num_rounds = 20)
+	{
+		const NavGraph& nav = g.freeze();
+		auto dyn = DynamicNavGraph::make(nav);
+
+		RouteBenchResult first;
+		std::vector<DStarLite> agents;
+		Timer t;
+		for (int i = 0; i < num_agents && i < (int)queries.size(); i++)
+		{
+			agents.push_back(DStarLite::make(dyn, nav.indexOf(queries[i].first), nav.indexOf(queries[i].second)));
+			first.queries++;
+			first.expanded += agents.back().stats.expanded;
+			if (!std::isinf(agents.back().cost())) first.found++, first.cost += agents.back().cost();
+		}
+		first.ms = t.ms();
+		print("D* Lite initial plan", first);
+
+		RouteBenchResult repair, scratch;
+		for (int round = 0; round < num_rounds; round++)
+		{
+			for (auto& a : agents)
+			{
+				auto path = a.path();
+				if (path.size() > 3) a.moveTo(path[3]);
+				if (path.size() > 8) dyn.removeNode(path[8]);
+			}
+
+			for (auto& a : agents)
+			{
+				Timer rt;
+				bool found = a.replan();
+				repair.ms += rt.ms();
+				repair.queries++;
+				repair.expanded += a.stats.expanded;
+				if (found) repair.found++, repair.cost += a.cost();
+
+				Timer st;
+				auto fresh = DStarLite::make(dyn, a.current(), a.target());
+				scratch.ms += st.ms();
+				scratch.queries++;
+				scratch.expanded += fresh.stats.expanded;
+				if (!std::isinf(fresh.cost())) scratch.found++, scratch.cost += fresh.cost();
+			}
+		}
+		print("D* Lite repair", repair);
+		print("D* Lite from scratch", scratch);
+		std::printf("incremental: %zu edge changes, x%.1f fewer expansions than replanning\n",
+			dyn.numChanges(), repair.expanded ? double(scratch.expanded) / repair.expanded : 0);
+	}
+
+	//a crowd heading for one rally point: a route call per agent
+	//against one flow field build plus next hop walks.
+	void benchFlowField(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries)
+	{
+		if (queries.empty()) return;
+		Node* goal = queries.front().second;
+
+		RouteBenchResult routes;
+		Timer rt;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			auto path = g.route(q.first, goal, &stats);
+			routes.queries++;
+			routes.expanded += stats.expanded;
+			if (path.size()) routes.found++;
+			routes.cost += pathCost(path);
+		}
+		routes.ms = rt.ms();
+		print("A* per agent", routes);
+
+		auto nav = g.snapshot();
+		RouteBenchResult field;
+		Timer ft;
+		auto f = FlowField::make(nav, nav->indexOf(goal));
+		field.expanded = SearchContext::local().stats.expanded;
+		for (const auto& q : queries)
+		{
+			int i = nav->indexOf(q.first);
+			field.queries++;
+			if (!f.reachable(i)) continue;
+			field.found++;
+			//walk it like an agent would
+			for (int curr = i; f.nextHop(curr) >= 0; curr = f.nextHop(curr))
+			{
+				field.cost += (nav->pos[f.nextHop(curr)] - nav->pos[curr]).mag();
+			}
+		}
+		field.ms = ft.ms();
+		print("flow field", field);
+		std::printf("flow field: %zu KB, x%.1f faster for %d agents\n",
+			f.memoryUsage() / 1024, field.ms > 0 ? routes.ms / field.ms : 0, field.queries);
+
+		//background rebuild while the old field stays readable
+		AsyncFlowField async;
+		async.refreshNow(nav, nav->indexOf(goal));
+		auto before = async.current();
+		Timer bt;
+		async.refresh(nav, nav->indexOf(queries.back().second));
+		int reads = 0;
+		while (async.isRefreshing())
+		{
+			reads += before->nextHop(nav->indexOf(queries[reads % queries.size()].first)) >= 0;
+		}
+		async.wait();
+		std::printf("flow field: background refresh %.2f ms, %d reads of the old field meanwhile\n", bt.ms(), reads);
+	}
+
+	//nearest / k-nearest / radius lookups against a linear scan over the
+	//node list, then removing a tenth of the nodes through the index.
+	void benchSpatialIndex(const Graph& g, int num_queries = 10000)
+	{
+		if (g.nodes.empty()) return;
+		float min_x = g.nodes.front()->pos.x, max_x = min_x;
+		float min_z = g.nodes.front()->pos.z, max_z = min_z;
+		for (const auto& n : g.nodes)
+		{
+			min_x = std::min(min_x, n->pos.x), max_x = std::max(max_x, n->pos.x);
+			min_z = std::min(min_z, n->pos.z), max_z = std::max(max_z, n->pos.z);
+		}
+
+		Rng rng(3);
+		std::vector<cmn::vf3d> pts;
+		for (int i = 0; i < num_queries; i++)
+		{
+			pts.push_back({ min_x + (max_x - min_x) * rng.nextFloat(), 0, min_z + (max_z - min_z) * rng.nextFloat() });
+		}
+
+		Timer bt;
+		SpatialIndex index = SpatialIndex::make(g.nodes);
+		double build_ms = bt.ms();
+
+		//linear scans are slow, only time a slice of them
+		int num_linear = std::max(1, num_queries / 100);
+		int mismatch = 0;
+		Timer lt;
+		for (int i = 0; i < num_linear; i++)
+		{
+			Node* best = nullptr;
+			float best_d = INFINITY;
+			for (const auto& n : g.nodes)
+			{
+				float d = (n->pos - pts[i]).mag2();
+				if (d < best_d) best_d = d, best = n;
+			}
+			mismatch += best && (index.nearest(pts[i])->pos - pts[i]).mag2() != best_d;
+		}
+		double linear_us = 1000 * lt.ms() / num_linear;
+
+		Timer nt;
+		//keeps the optimizer from dropping the loops
+		volatile size_t sink = 0;
+		for (const auto& p : pts) sink += (size_t)index.nearest(p);
+		double nearest_us = 1000 * nt.ms() / num_queries;
+
+		Timer kt;
+		for (const auto& p : pts) sink += index.kNearest(p, 8).size();
+		double knn_us = 1000 * kt.ms() / num_queries;
+
+		std::vector<Node*> found;
+		float rad = 4 * index.cellSize();
+		Timer rt;
+		for (const auto& p : pts)
+		{
+			found.clear();
+			index.radius(p, rad, found);
+			sink += found.size();
+		}
+		double radius_us = 1000 * rt.ms() / num_queries;
+
+		Timer dt;
+		int removed = 0, k = 0;
+		for (const auto& n : g.nodes)
+		{
+			if (k++ % 10 == 0) removed += index.remove(n);
+		}
+		double remove_us = removed ? 1000 * dt.ms() / removed : 0;
+
+		std::printf("spatial index: %d nodes, %.2f ms build, %zu KB, %d mismatches against the scan\n",
+			(int)g.nodes.size(), build_ms, index.memoryUsage() / 1024, mismatch);
+		std::printf("  linear nearest %9.3f us, nearest %7.3f us (x%.0f), 8-nearest %7.3f us, radius %.1f %7.3f us, remove %7.3f us\n",
+			linear_us, nearest_us, nearest_us > 0 ? linear_us / nearest_us : 0, knn_us, rad, radius_us, remove_us);
+	}
+
+	//plain A*, A* + string pulling and Theta*: waypoints, cost and how many
+	//line of sight checks each pays for it, then what a single check costs
+	//through the bvh vs testing every triangle.
+	void benchLineOfSight(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries, const TriangleBVH& obstacles)
+	{
+		RouteOptions smooth;
+		smooth.obstacles = &obstacles;
+		smooth.smooth = true;
+
+		RouteOptions theta;
+		theta.mode = ROUTE_THETA;
+		theta.obstacles = &obstacles;
+
+		long long raw_points = 0, smooth_points = 0, los_checks = 0;
+		long long theta_points = 0, theta_checks = 0;
+		RouteBenchResult raw, smoothed, any_angle;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			Timer rt;
+			auto path = g.route(q.first, q.second, &stats);
+			raw.ms += rt.ms();
+			raw.queries++;
+			raw.expanded += stats.expanded;
+			raw.cost += pathCost(path);
+			raw_points += path.size();
+			if (path.size()) raw.found++;
+
+			Timer st;
+			path = g.route(q.first, q.second, &stats, smooth);
+			smoothed.ms += st.ms();
+			smoothed.queries++;
+			smoothed.expanded += stats.expanded;
+			smoothed.cost += pathCost(path);
+			smooth_points += path.size();
+			los_checks += stats.los_checks;
+			if (path.size()) smoothed.found++;
+
+			Timer tt;
+			path = g.route(q.first, q.second, &stats, theta);
+			any_angle.ms += tt.ms();
+			any_angle.queries++;
+			any_angle.expanded += stats.expanded;
+			any_angle.cost += pathCost(path);
+			theta_points += path.size();
+			theta_checks += stats.los_checks;
+			if (path.size()) any_angle.found++;
+		}
+		print("A*", raw);
+		print("A* + smoothing", smoothed);
+		print("Theta*", any_angle);
+		std::printf("smoothing: %lld -> %lld waypoints, %lld line of sight checks, %d triangles in %d bvh nodes\n",
+			raw_points, smooth_points, los_checks, obstacles.numTriangles(), obstacles.numNodes());
+		auto gain = [&](const RouteBenchResult& r) { return raw.cost > 0 ? 100 * (raw.cost - r.cost) / raw.cost : 0; };
+		std::printf("Theta*: %lld waypoints, %lld line of sight checks (x%.0f smoothing's), +%.2f ms over A*, %.2f%% shorter (smoothing %.2f%%)\n",
+			theta_points, theta_checks, los_checks ? double(theta_checks) / los_checks : 0,
+			any_angle.ms - raw.ms, gain(any_angle), gain(smoothed));
+
+		//same segments, bvh vs a flat loop over a copy of every triangle
+		std::vector<std::pair<cmn::vf3d, cmn::vf3d>> segs;
+		for (const auto& q : queries) segs.push_back({ q.first->pos, q.second->pos });
+
+		TriangleBVH flat = obstacles;
+		Timer bt;
+		int blocked = 0;
+		for (const auto& s : segs) blocked += obstacles.segmentBlocked(s.first, s.second);
+		double bvh_us = 1000 * bt.ms() / segs.size();
+
+		//a bvh with one leaf is the brute force loop
+		flat.buildFlat();
+		Timer ft;
+		int flat_blocked = 0;
+		for (const auto& s : segs) flat_blocked += flat.segmentBlocked(s.first, s.second);
+		double flat_us = 1000 * ft.ms() / segs.size();
+		std::printf("line of sight: bvh %.3f us, all triangles %.3f us (x%.0f), %d/%d blocked (%d)\n",
+			bvh_us, flat_us, bvh_us > 0 ? flat_us / bvh_us : 0, blocked, (int)segs.size(), flat_blocked);
+	}
+
+	//freezes a copy of g under each cost policy, then the same queries.
+	//policies only cost anything at freeze time, the searches just read
+	//the stored costs, so query time should follow expansions alone.
+	void benchCostPolicy(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries)
+	{
+		//stripes across x, every other one twice as slow to cross
+		float min_x = INFINITY, max_x = -INFINITY;
+		for (const auto& n : g.nodes) min_x = std::min(min_x, n->pos.x), max_x = std::max(max_x, n->pos.x);
+		const float stripe = std::max(1e-3f, (max_x - min_x) / 8);
+		auto region = makeRegionCost([=](const cmn::vf3d& p) { return int((p.x - min_x) / stripe) % 2; }, { 1, 2 });
+
+		auto run = [&](const char* label, Graph& copy) {
+			Timer ft;
+			const NavGraph& nav = copy.freeze();
+			double freeze_ms = ft.ms();
+
+			//queries are nodes of g, map them over by index
+			std::vector<Node*> all(copy.nodes.begin(), copy.nodes.end());
+			std::vector<std::pair<Node*, Node*>> mapped;
+			for (const auto& q : queries) mapped.push_back({ all[g.freeze().indexOf(q.first)], all[g.freeze().indexOf(q.second)] });
+
+			RouteBenchResult r = benchRoute(copy, mapped);
+			print(label, r);
+			std::printf("%-24s freeze %.2f ms, %d edges, %s, %.1f ns/expansion\n", "", freeze_ms, nav.numEdges(),
+				nav.symmetric ? "symmetric" : "asymmetric", r.expanded ? 1e6 * r.ms / r.expanded : 0);
+		};
+
+		Graph plain = g;
+		plain.resetCostPolicy();
+		run("distance cost", plain);
+
+		//synthetic grids are flat, give them some rolling hills to climb
+		Graph slope = g;
+		bool flat = true;
+		for (const auto& n : slope.nodes) flat = flat && n->pos.y == slope.nodes.front()->pos.y;
+		if (flat)
+		{
+			for (auto& n : slope.nodes) n->pos.y += 2 * std::sin(n->pos.x / 7) * std::cos(n->pos.z / 9);
+			slope.markDirty();
+			run("distance cost, hills", slope);
+		}
+		slope.setCostPolicy(SlopeCost{});
+		run("slope cost", slope);
+
+		Graph regions = g;
+		regions.setCostPolicy(region);
+		run("region cost", regions);
+	}
+
+	//weighted A* and focal search against exact A* on the same queries:
+	//expansions, time, and how much longer the paths get (mean and worst
+	//ratio). worst must stay within the weight.
+	void benchSuboptimal(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries)
+	{
+		std::vector<float> optimal;
+		RouteBenchResult exact;
+		Timer et;
+		for (const auto& q : queries)
+		{
+			RouteStats stats;
+			auto path = g.route(q.first, q.second, &stats);
+			exact.expanded += stats.expanded;
+			optimal.push_back(pathCost(path));
+		}
+		exact.ms = et.ms();
+
+		const float weights[]{ 1.1f, 1.25f, 1.5f, 2, 3 };
+		const RouteMode modes[]{ ROUTE_ASTAR, ROUTE_FOCAL };
+		for (const auto& mode : modes)
+		{
+			for (const auto& w : weights)
+			{
+				RouteOptions opts;
+				opts.mode = mode;
+				opts.weight = w;
+
+				RouteBenchResult r;
+				double ratio_sum = 0, worst = 1;
+				int counted = 0;
+				Timer t;
+				std::vector<std::vector<Node*>> paths;
+				paths.reserve(queries.size());
+				for (const auto& q : queries)
+				{
+					RouteStats stats;
+					paths.push_back(g.route(q.first, q.second, &stats, opts));
+					r.queries++;
+					r.expanded += stats.expanded;
+					if (paths.back().size()) r.found++;
+				}
+				r.ms = t.ms();
+
+				for (int i = 0; i < (int)paths.size(); i++)
+				{
+					float cost = pathCost(paths[i]);
+					r.cost += cost;
+					if (optimal[i] <= 0) continue;
+					ratio_sum += cost / optimal[i];
+					worst = std::max(worst, double(cost / optimal[i]));
+					counted++;
+				}
+
+				char label[64];
+				std::snprintf(label, sizeof(label), "%s w=%.2f", mode == ROUTE_FOCAL ? "focal" : "weighted A*", w);
+				print(label, r);
+				std::printf("%-24s %.2fx fewer expansions, %.2fx faster, cost ratio %.4f mean %.4f worst%s\n", "",
+					r.expanded ? double(exact.expanded) / r.expanded : 0, r.ms > 0 ? exact.ms / r.ms : 0,
+					counted ? ratio_sum / counted : 1, worst, worst > w * 1.0001 ? " OVER BOUND" : "");
+			}
+		}
+	}
+
+	//same queries as resumable requests with a per step expansion budget.
+	//the point is the worst single step, which is what a frame has to
+	//absorb, against the worst blocking route call.
+	void benchTimeSliced(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries, int budget = 256)
+	{
+		std::shared_ptr<const NavGraph> nav = g.snapshot();
+
+		double worst_route_us = 0;
+		for (const auto& q : queries)
+		{
+			Timer t;
+			auto path = nav->route(nav->indexOf(q.first), nav->indexOf(q.second));
+			worst_route_us = std::max(worst_route_us, 1000 * t.ms());
+		}
+
+		RouteBenchResult r;
+		PathRequest req;
+		double worst_step_us = 0;
+		long long total_slices = 0;
+		int max_slices = 0, mismatch = 0;
+		Timer t;
+		for (const auto& q : queries)
+		{
+			req.start(nav, q.first, q.second);
+			while (!req.done())
+			{
+				Timer st;
+				req.step(budget);
+				worst_step_us = std::max(worst_step_us, 1000 * st.ms());
+			}
+			r.queries++;
+			r.expanded += req.stats().expanded;
+			total_slices += req.numSlices();
+			max_slices = std::max(max_slices, req.numSlices());
+			const auto& path = req.result();
+			if (path.size()) r.found++;
+			for (int i = 1; i < (int)path.size(); i++) r.cost += (nav->pos[path[i]] - nav->pos[path[i - 1]]).mag();
+			mismatch += path != nav->route(nav->indexOf(q.first), nav->indexOf(q.second));
+		}
+		r.ms = t.ms();
+
+		char label[64];
+		std::snprintf(label, sizeof(label), "A* sliced by %d", budget);
+		print(label, r);
+		std::printf("time slicing: %.1f steps/query (max %d), worst step %.1f us vs worst blocking route %.1f us\n",
+			r.queries ? double(total_slices) / r.queries : 0, max_slices, worst_step_us, worst_route_us);
+		if (mismatch) std::printf("time slicing: %d paths differ from a blocking route\n", mismatch);
+	}
+
+	//same queries through the background service. what matters for the
+	//frame is how long submit() holds up the caller, then how long until
+	//every callback has run. every 4th request is cancelled right away.
+	void benchPathService(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries)
+	{
+		std::shared_ptr<const NavGraph> nav = g.snapshot();
+		PathService service;
+
+		RouteBenchResult r;
+		std::vector<std::vector<int>> paths(queries.size());
+		std::vector<bool> answered(queries.size(), false);
+		double worst_submit_us = 0;
+
+		Timer t;
+		for (int i = 0; i < (int)queries.size(); i++)
+		{
+			const auto& q = queries[i];
+			Timer st;
+			PathTicket ticket = service.submit(nav, q.first, q.second, [&, i](const PathResult& res) {
+				answered[i] = true;
+				paths[i] = res.path;
+				r.expanded += res.stats.expanded;
+			}, i % 3);
+			if (i % 4 == 3) service.cancel(ticket);
+			worst_submit_us = std::max(worst_submit_us, 1000 * st.ms());
+		}
+		double submit_ms = t.ms();
+		service.drain();
+		r.ms = t.ms();
+
+		int mismatch = 0, late_callbacks = 0;
+		for (int i = 0; i < (int)queries.size(); i++)
+		{
+			if (!answered[i]) continue;
+			if (i % 4 == 3) late_callbacks++;
+			r.queries++;
+			if (paths[i].size()) r.found++;
+			for (int k = 1; k < (int)paths[i].size(); k++) r.cost += (nav->pos[paths[i][k]] - nav->pos[paths[i][k - 1]]).mag();
+			mismatch += paths[i] != nav->route(nav->indexOf(queries[i].first), nav->indexOf(queries[i].second));
+		}
+
+		char label[64];
+		std::snprintf(label, sizeof(label), "service %d threads", service.numThreads());
+		print(label, r);
+		std::printf("path service: submit %.2f us avg, %.2f us worst, %d cancelled\n",
+			1000 * submit_ms / std::max<size_t>(1, queries.size()), worst_submit_us, (int)queries.size() - r.queries);
+		if (mismatch || late_callbacks) std::printf("path service: %d paths differ, %d cancelled callbacks ran\n", mismatch, late_callbacks);
+	}
+
+	//save, then both ways of getting it back: Graph::load rebuilding nodes
+	//and links, and a mapped view that routes without deserializing.
+	void benchNavGraphFile(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries, const char* filename = "navgraph_bench.bin")
+	{
+		const NavGraph& nav = g.freeze();
+
+		Timer st;
+		ReturnCode status = g.save(filename);
+		double save_ms = st.ms();
+		if (!status.valid)
+		{
+			std::printf("navgraph file: save failed, %s\n", status.msg.c_str());
+			return;
+		}
+
+		Graph loaded;
+		Timer lt;
+		status = loaded.load(filename);
+		double load_ms = lt.ms();
+
+		MappedNavGraph mapped;
+		Timer mt;
+		ReturnCode map_status = MappedNavGraph::open(mapped, filename);
+		double map_ms = mt.ms();
+
+		if (status.valid && map_status.valid)
+		{
+			std::printf("navgraph file: %zu KB, save %.2f ms, Graph::load %.2f ms, mapped view %.3f ms\n",
+				NavGraphView::fileSize(nav.size(), nav.numEdges()) / 1024, save_ms, load_ms, map_ms);
+
+			RouteBenchResult r;
+			int mismatch = 0;
+			Timer rt;
+			for (const auto& q : queries)
+			{
+				RouteStats stats;
+				auto path = mapped.view.route(nav.indexOf(q.first), nav.indexOf(q.second), &stats);
+				r.queries++;
+				r.expanded += stats.expanded;
+				if (path.size()) r.found++;
+				for (int i = 1; i < (int)path.size(); i++) r.cost += (mapped.view.pos(path[i]) - mapped.view.pos(path[i - 1])).mag();
+				mismatch += path != nav.route(nav.indexOf(q.first), nav.indexOf(q.second));
+			}
+			r.ms = rt.ms();
+			print("A* on mapped file", r);
+			if (mismatch) std::printf("navgraph file: %d paths differ from the in-memory graph\n", mismatch);
+		}
+		else
+		{
+			std::printf("navgraph file: load failed, %s / %s\n", status.msg.c_str(), map_status.msg.c_str());
+		}
+
+		mapped = MappedNavGraph{};
+		std::remove(filename);
+	}
+
+	//rough heap footprint of the linked list representation: the node
+	//and link pools, plus a malloc'd list entry per node in Graph::nodes.
+	size_t listMemoryUsage(const Graph& g)
+	{
+		const size_t header = 16;
+		const size_t list_node = 2 * sizeof(void*) + sizeof(Node*) + header;
+		return g.nodes.size() * list_node + g.poolMemoryUsage();
+	}
+
+	//what-if copies: a fresh clone, then cloning over the same scratch
+	//graph again (pools already sized and touched), against the old
+	//new-per-node copy that remapped links through a hash map.
+	void benchClone(const Graph& g, int repeats = 5)
+	{
+		g.freeze();
+
+		double hash_ms = 0;
+		for (int r = 0; r < repeats; r++)
+		{
+			Timer t;
+			std::vector<std::unique_ptr<Node>> copy;
+			std::unordered_map<Node*, Node*> g2me;
+			for (const auto& gn : g.nodes)
+			{
+				copy.push_back(std::make_unique<Node>(gn->pos));
+				g2me[gn] = copy.back().get();
+			}
+			for (const auto& gn : g.nodes)
+			{
+				Node* n = g2me[gn];
+				for (const auto& go : gn->links) n->links.push_back(g2me[go]);
+			}
+			hash_ms += t.ms();
+		}
+
+		Timer ft;
+		Graph fresh = g;
+		double fresh_ms = ft.ms();
+
+		//the first copy sizes and touches scratch's pools, time the ones after
+		Graph scratch = g;
+		double reuse_ms = 0;
+		for (int r = 0; r < repeats; r++)
+		{
+			Timer t;
+			scratch = g;
+			reuse_ms += t.ms();
+		}
+
+		std::printf("clone %d nodes: fresh %.2f ms, into scratch %.2f ms, hash map remap %.2f ms (x%.1f), pools %zu KB\n",
+			(int)g.nodes.size(), fresh_ms, reuse_ms / repeats, hash_ms / repeats,
+			reuse_ms > 0 ? hash_ms / reuse_ms : 0, scratch.poolMemoryUsage() / 1024);
+	}
+
+	//queries whose goal is on an island, like the ones setupNodes leaves
+	//behind obstacles. the component check against the full search it saves.
+	void benchUnreachable(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries)
+	{
+		Graph copy = g;
+		const NavGraph* nav = &copy.freeze();
+
+		//no islands? put one off to the side
+		if (nav->num_components < 2)
+		{
+			float max_x = -INFINITY;
+			for (const auto& n : copy.nodes) max_x = std::max(max_x, n->pos.x);
+			Node* a = copy.addNode({ max_x + 10, 0, 0 });
+			Node* b = copy.addNode({ max_x + 11, 0, 0 });
+			a->links.push_back(b);
+			b->links.push_back(a);
+			copy.markDirty();
+			nav = &copy.freeze();
+		}
+
+		//starts in the biggest component, goals anywhere else
+		std::vector<int> comp_size(nav->num_components, 0);
+		for (const auto& c : nav->component) comp_size[c]++;
+		int main_comp = std::max_element(comp_size.begin(), comp_size.end()) - comp_size.begin();
+		std::vector<int> island, mainland;
+		for (int i = 0; i < nav->size(); i++)
+		{
+			if (nav->component[i] == main_comp) mainland.push_back(i);
+			else island.push_back(i);
+		}
+		if (island.empty() || mainland.empty()) return;
+
+		Rng rng(5);
+		std::vector<std::pair<int, int>> cut_off;
+		for (int q = 0; q < (int)queries.size(); q++)
+		{
+			cut_off.push_back({ mainland[rng.nextInt(mainland.size())], island[rng.nextInt(island.size())] });
+		}
+
+		SearchContext ctx;
+		long long searched_expanded = 0;
+		int found = 0;
+		Timer st;
+		for (const auto& q : cut_off)
+		{
+			found += !nav->routeAStar(q.first, q.second, ctx).empty();
+			searched_expanded += ctx.stats.expanded;
+		}
+		double searched_ms = st.ms();
+
+		Timer ct;
+		for (const auto& q : cut_off)
+		{
+			found += !nav->route(q.first, q.second, ctx).empty();
+		}
+		double checked_ms = ct.ms();
+
+		NavGraph relabel = *nav;
+		Timer lt;
+		relabel.buildComponents();
+		double label_ms = lt.ms();
+
+		std::printf("unreachable goals (%d components): full search %.2f us/query (%lld expanded), component check %.3f us/query, %d found, labels %.2f ms per freeze\n",
+			nav->num_components, 1000 * searched_ms / cut_off.size(), searched_expanded / (long long)cut_off.size(),
+			1000 * checked_ms / cut_off.size(), found, label_ms);
+
+		//editable layer: restoring merges right away, a cut relabels on the next ask
+		auto dyn = DynamicNavGraph::make(*nav);
+		int victim = mainland[rng.nextInt(mainland.size())];
+		dyn.connected(0, 0);
+		dyn.removeNode(victim);
+		Timer rt;
+		bool after_cut = dyn.connected(cut_off[0].first, cut_off[0].second);
+		double cut_ms = rt.ms();
+		dyn.restoreNode(victim);
+		Timer mt;
+		bool after_restore = dyn.connected(cut_off[0].first, cut_off[0].second);
+		double restore_ms = mt.ms();
+		std::printf("%-24s dynamic graph: first check after a cut %.3f ms, after a restore %.4f ms%s\n", "",
+			cut_ms, restore_ms, after_cut || after_restore ? ", WRONG" : "");
+	}
+
+	//num_points x num_points travel costs, as the AI director asks for them.
+	//a pair at a time is too slow to run in full, so sample_rows rows of
+	//routeBatch stand in for it, and check the tables on the way.
+	void benchDistanceTable(const Graph& g, int num_points = 200, int sample_rows = 4)
+	{
+		const NavGraph& nav = g.freeze();
+		if (nav.size() < 2) return;
+
+		Rng rng(21);
+		std::vector<int> points;
+		for (int i = 0; i < num_points; i++) points.push_back(rng.nextInt(nav.size()));
+
+		sample_rows = std::min(sample_rows, num_points);
+		std::vector<std::pair<int, int>> pairs;
+		for (int r = 0; r < sample_rows; r++)
+		{
+			for (const auto& t : points) pairs.push_back({ points[r], t });
+		}
+
+		RouteStats stats;
+		Timer pt;
+		auto paths = routeBatch(nav, pairs, ThreadPool::shared(), &stats);
+		double pair_ms = pt.ms() * num_points / sample_rows;
+		long long pair_expanded = (long long)stats.expanded * num_points / sample_rows;
+
+		std::vector<float> expected;
+		for (int i = 0; i < (int)paths.size(); i++)
+		{
+			float c = paths[i].empty() && pairs[i].first != pairs[i].second ? INFINITY : 0;
+			for (int k = 1; k < (int)paths[i].size(); k++) c += nav.edgeCost(paths[i][k - 1], paths[i][k]);
+			expected.push_back(c);
+		}
+
+		//off entries against the sampled routes
+		auto check = [&](const DistanceTable& t) {
+			int off = 0;
+			for (int i = 0; i < (int)expected.size(); i++)
+			{
+				float got = t.at(i / num_points, i % num_points);
+				if (std::isinf(got) != std::isinf(expected[i]) ||
+					(!std::isinf(got) && std::abs(got - expected[i]) > 1e-3f * std::max(1.f, expected[i]))) off++;
+			}
+			return off;
+		};
+
+		std::printf("distance table %dx%d: pairwise routes %.1f ms (%lld expanded, from %d rows)\n",
+			num_points, num_points, pair_ms, pair_expanded, sample_rows);
+
+		int max_threads = std::max(1u, std::thread::hardware_concurrency());
+		for (int threads = 1;; threads = std::min(2 * threads, max_threads))
+		{
+			ThreadPool pool(threads);
+			Timer t;
+			DistanceTable table = distanceTable(nav, points, points, pool, &stats);
+			double ms = t.ms();
+			std::printf("%-24s dijkstra per source, %2d threads: %.1f ms (x%.1f), %d expanded, %d wrong\n", "",
+				threads, ms, ms > 0 ? pair_ms / ms : 0, stats.expanded, check(table));
+			if (threads == max_threads) break;
+		}
+
+		Timer bt;
+		auto ch = ContractionHierarchy::build(nav);
+		double build_ms = bt.ms();
+		Timer t;
+		DistanceTable table = distanceTable(ch, points, points, ThreadPool::shared(), &stats);
+		double ms = t.ms();
+		std::printf("%-24s CH buckets, %2d threads: %.2f ms (x%.0f) after a %.0f ms build, %d expanded, %d wrong\n", "",
+			ThreadPool::shared().size(), ms, ms > 0 ? pair_ms / ms : 0, build_ms, stats.expanded, check(table));
+	}
+
+	//same queries after numbering the nodes each way NodeOrder offers.
+	//the list as built, then shuffled like scattered sample output, then
+	//reordered from the shuffle. gap is the mean |i - j| over edges i -> j,
+	//the smaller it is, the more of a search's memory traffic hits cache.
+	void benchNodeOrder(const Graph& g, const std::vector<std::pair<Node*, Node*>>& queries, int num_sweeps = 8)
+	{
+		//the copy's list is in g's index order, queries map over by index
+		Graph copy = g;
+		std::vector<Node*> all(copy.nodes.begin(), copy.nodes.end());
+		std::vector<std::pair<Node*, Node*>> mapped;
+		for (const auto& q : queries) mapped.push_back({ all[g.freeze().indexOf(q.first)], all[g.freeze().indexOf(q.second)] });
+		if (all.size() < 2) return;
+
+		double base_ms = 0, base_sweep_ms = 0;
+		auto run = [&](const char* label, NodeOrder order) {
+			copy.setNodeOrder(order);
+			Timer ft;
+			const NavGraph& nav = copy.freeze();
+			double freeze_ms = ft.ms();
+
+			double gap = 0;
+			for (int i = 0; i < nav.size(); i++)
+			{
+				for (int e = nav.offsets[i]; e < nav.offsets[i + 1]; e++) gap += std::abs(nav.nbrs[e] - i);
+			}
+			gap /= std::max(1, nav.numEdges());
+
+			RouteBenchResult r = benchRoute(copy, mapped);
+
+			//one to all, every node's memory gets touched
+			SearchContext ctx;
+			Timer st;
+			for (int s = 0; s < num_sweeps; s++) nav.dijkstra(nav.indexOf(mapped[s % mapped.size()].first), ctx);
+			double sweep_ms = st.ms() / num_sweeps;
+
+			if (base_ms == 0) base_ms = r.ms, base_sweep_ms = sweep_ms;
+			print(label, r);
+			std::printf("%-24s freeze %.2f ms, gap %.0f, A* x%.2f, dijkstra sweep %.2f ms x%.2f\n", "",
+				freeze_ms, gap, r.ms > 0 ? base_ms / r.ms : 0, sweep_ms, sweep_ms > 0 ? base_sweep_ms / sweep_ms : 0);
+		};
+
+		run("order: as built", ORDER_LIST);
+
+		Rng rng(17);
+		for (int i = (int)all.size() - 1; i > 0; i--) std::swap(all[i], all[rng.nextInt(i + 1)]);
+		copy.nodes.assign(all.begin(), all.end());
+		copy.markDirty();
+		base_ms = 0;
+		run("order: shuffled", ORDER_LIST);
+		run("order: hilbert", ORDER_HILBERT);
+		run("order: rcm", ORDER_RCM);
+	}
+
+	//two agents on one node, or two swapping through the same link, this tick
+	int countCollisions(const std::vector<int>& before, const std::vector<int>& after)
+	{
+		std::unordered_map<int, int> on_node;
+		std::unordered_map<uint64_t, int> moves;
+		int collisions = 0;
+		for (int a = 0; a < (int)after.size(); a++)
+		{
+			collisions += on_node[after[a]]++ > 0;
+			if (before[a] == after[a]) continue;
+			moves[(uint64_t(uint32_t(before[a])) << 32) | uint32_t(after[a])]++;
+		}
+		for (const auto& m : moves)
+		{
+			uint64_t back = (m.first << 32) | (m.first >> 32);
+			if (m.first < back && moves.count(back)) collisions++;
+		}
+		return collisions;
+	}
+
+	//two crowds crossing the map in opposite directions, through whatever
+	//gaps the buildings leave. independent A* paths followed a node per tick
+	//against WHCA*, counting the collisions local avoidance would have to sort out.
+	void benchCooperative(const Graph& g, int num_agents = 1000, int window = 16)
+	{
+		std::shared_ptr<const NavGraph> nav = g.snapshot();
+		const int n = nav->size();
+		if (n < 2 * num_agents) return;
+
+		//left and right tenths, sorted by x
+		std::vector<int> by_x(n);
+		for (int i = 0; i < n; i++) by_x[i] = i;
+		std::sort(by_x.begin(), by_x.end(), [&](int a, int b) { return nav->pos[a].x < nav->pos[b].x; });
+		const int band = std::max(num_agents, n / 10);
+		std::vector<int> left(by_x.begin(), by_x.begin() + band), right(by_x.end() - band, by_x.end());
+		Rng rng(23);
+		for (int i = band - 1; i > 0; i--)
+		{
+			std::swap(left[i], left[rng.nextInt(i + 1)]);
+			std::swap(right[i], right[rng.nextInt(i + 1)]);
+		}
+
+		//distinct starts and goals, half going each way
+		std::vector<std::pair<int, int>> agents;
+		for (int a = 0; a < num_agents; a++)
+		{
+			if (a % 2) agents.push_back({ left[a], right[a] });
+			else agents.push_back({ right[a], left[a] });
+		}
+
+		Landmarks lm = nav->makeLandmarks(8);
+		RouteOptions alt;
+		alt.landmarks = &lm;
+
+		//independent: everyone takes their own shortest path
+		Timer it;
+		std::vector<std::vector<int>> paths;
+		for (const auto& a : agents) paths.push_back(nav->route(a.first, a.second, nullptr, alt));
+		double independent_ms = it.ms();
+
+		int independent_collisions = 0, independent_ticks = 0;
+		std::vector<int> before(num_agents), after(num_agents);
+		for (int a = 0; a < num_agents; a++) before[a] = agents[a].first;
+		for (bool moving = true; moving; independent_ticks++)
+		{
+			moving = false;
+			for (int a = 0; a < num_agents; a++)
+			{
+				const auto& p = paths[a];
+				int k = std::min<int>(independent_ticks + 1, (int)p.size() - 1);
+				after[a] = p.empty() ? before[a] : p[k];
+				moving = moving || k + 1 < (int)p.size();
+			}
+			independent_collisions += countCollisions(before, after);
+			before.swap(after);
+		}
+
+		CooperativeOptions opts;
+		opts.window = window;
+		opts.replan_every = window / 2;
+		opts.route = alt;
+
+		for (int threads = 1;; threads = std::min(2 * threads, (int)ThreadPool::shared().size()))
+		{
+			ThreadPool pool(threads);
+			CooperativePlanner coop = CooperativePlanner::make(nav, opts);
+			for (const auto& a : agents) coop.addAgent(a.first, a.second);
+
+			int collisions = 0, replans = 0, retried = 0, stuck = 0, guided = 0, arrived = 0;
+			long long expanded = 0;
+			double plan_ms = 0;
+			const int max_ticks = 4 * independent_ticks;
+			int ticks = 0;
+			for (; ticks < max_ticks; ticks++)
+			{
+				for (int a = 0; a < num_agents; a++) before[a] = coop.position(a);
+				uint32_t planned = coop.plannedAt();
+				coop.update(pool);
+				if (coop.plannedAt() != planned || ticks == 0)
+				{
+					replans++;
+					plan_ms += coop.stats.ms;
+					expanded += coop.stats.expanded;
+					retried += coop.stats.retried;
+					stuck += coop.stats.stuck;
+					guided += coop.stats.guided;
+				}
+				arrived = 0;
+				for (int a = 0; a < num_agents; a++)
+				{
+					after[a] = coop.position(a);
+					arrived += coop.arrived(a);
+				}
+				collisions += countCollisions(before, after);
+				if (arrived == num_agents) break;
+			}
+
+			if (threads == 1)
+			{
+				std::printf("cooperative %d agents: independent A* %.1f ms, %d ticks, %d collisions\n",
+					num_agents, independent_ms, independent_ticks, independent_collisions);
+			}
+			std::printf("%-24s WHCA* window %d, %2d threads: %.2f ms per replan (%d), %lld expanded, %d guides, %d retried, %d stuck, %d/%d arrived in %d ticks, %d collisions, table %zu KB\n", "",
+				window, threads, replans ? plan_ms / replans : 0, replans, expanded / std::max(1, replans), guided, retried, stuck,
+				arrived, num_agents, ticks + 1, collisions, coop.reservations().memoryUsage() / 1024);
+
+			if (threads == ThreadPool::shared().size()) break;
+		}
+	}
+
+	//num_agents walking back and forth along num_routes shared routes, for
+	//num_frames at 30 fps. the same walk as an array of agent structs, each
+	//with its own copy of the path, on one thread for comparison.
+	void benchAgents(const Graph& g, int num_agents = 10000, int num_routes = 512, int num_frames = 120)
+	{
+		std::shared_ptr<const NavGraph> nav = g.snapshot();
+		if (nav->size() < 2) return;
+		const float dt = 1 / 30.f;
+
+		Rng rng(25);
+		std::vector<std::pair<int, int>> idx;
+		for (int i = 0; i < num_routes; i++) idx.push_back({ rng.nextInt(nav->size()), rng.nextInt(nav->size()) });
+		std::vector<std::vector<int>> routes;
+		for (auto& r : routeBatch(*nav, idx))
+		{
+			if (r.size() > 1) routes.push_back(std::move(r));
+		}
+		if (routes.empty()) return;
+
+		std::vector<float> speeds(num_agents);
+		std::vector<int> first(num_agents);
+		for (int a = 0; a < num_agents; a++)
+		{
+			speeds[a] = 1 + 2 * rng.nextFloat();
+			first[a] = rng.nextInt(routes.size());
+		}
+
+		//structs, the way agents usually start out
+		struct Walker
+		{
+			cmn::vf3d pos, vel;
+			float speed;
+			std::vector<cmn::vf3d> path;
+			int waypoint;
+		};
+		std::vector<Walker> walkers(num_agents);
+		for (int a = 0; a < num_agents; a++)
+		{
+			Walker& w = walkers[a];
+			for (const auto& v : routes[first[a]]) w.path.push_back(nav->pos[v]);
+			w.pos = w.path[0];
+			w.speed = speeds[a];
+			w.waypoint = 0;
+		}
+		int walker_arrivals = 0;
+		Timer aos;
+		for (int f = 0; f < num_frames; f++)
+		{
+			for (auto& w : walkers)
+			{
+				cmn::vf3d d = w.path[w.waypoint] - w.pos;
+				float dist = d.mag(), reach = w.speed * dt;
+				if (dist <= reach)
+				{
+					w.pos = w.path[w.waypoint];
+					w.vel = {};
+					//turn around at either end
+					if (++w.waypoint == (int)w.path.size())
+					{
+						std::reverse(w.path.begin(), w.path.end());
+						w.waypoint = 0;
+						walker_arrivals++;
+					}
+					continue;
+				}
+				w.vel = d * (w.speed / dist);
+				w.pos += w.vel * dt;
+			}
+		}
+		double aos_ms = aos.ms() / num_frames;
+		std::printf("agents %d on %zu routes: structs %.2f ms/frame %.1f ns/agent, %d arrivals\n",
+			num_agents, routes.size(), aos_ms, 1e6 * aos_ms / num_agents, walker_arrivals);
+
+		for (int threads = 1;; threads = std::min(2 * threads, (int)ThreadPool::shared().size()))
+		{
+			ThreadPool pool(threads);
+			AgentSystem agents;
+			//each route both ways, back[h] is h reversed
+			std::vector<PathHandle> forward, back;
+			for (const auto& r : routes)
+			{
+				PathHandle h = agents.addPath(*nav, r);
+				PathHandle b = agents.addPath(*nav, std::vector<int>(r.rbegin(), r.rend()));
+				back.resize(std::max(h, b) + 1);
+				back[h] = b, back[b] = h;
+				forward.push_back(h);
+			}
+			for (int a = 0; a < num_agents; a++)
+			{
+				agents.addAgent(nav->pos[routes[first[a]][0]], speeds[a]);
+				agents.setPath(a, forward[first[a]]);
+			}
+
+			int arrivals = 0;
+			double update_ms = 0;
+			Timer total;
+			for (int f = 0; f < num_frames; f++)
+			{
+				Timer t;
+				arrivals += agents.update(dt, pool);
+				update_ms += t.ms();
+				for (const auto& a : agents.justArrived()) agents.setPath(a, back[agents.path[a]]);
+			}
+			double frame_ms = total.ms() / num_frames;
+			std::printf("%-24s SoA %2d threads: %.2f ms/frame (%.2f update) %.1f ns/agent x%.2f over structs, %d arrivals, %zu KB\n", "",
+				threads, frame_ms, update_ms / num_frames, 1e6 * frame_ms / num_agents, frame_ms > 0 ? aos_ms / frame_ms : 0,
+				arrivals, agents.memoryUsage() / 1024);
+
+			if (threads == ThreadPool::shared().size()) break;
+		}
+	}
+
+	//runs against whatever graph is passed in, e.g. the demo's delaunay graph.
+	void runRouteBenchmark(const Graph& g, int num_queries = 200)
+	{
+		const NavGraph& nav = g.freeze();
+		std::printf("route benchmark: %d nodes %d links, list graph ~%zu KB, csr graph %zu KB\n",
+			nav.size(), nav.numEdges(), listMemoryUsage(g) / 1024, nav.memoryUsage() / 1024);
+		auto queries = makeQueries(g, num_queries);
+		print("A*", benchRoute(g, queries));
+
+		RouteOptions bidir;
+		bidir.mode = ROUTE_BIDIRECTIONAL;
+		print("bidirectional A*", benchRoute(g, queries, bidir));
+
+		Timer lm_timer;
+		Landmarks lm = nav.makeLandmarks(8);
+		std::printf("landmarks: %d picked in %.2f ms, %zu KB\n", lm.num(), lm_timer.ms(), lm.memoryUsage() / 1024);
+
+		RouteOptions alt;
+		alt.landmarks = &lm;
+		print("ALT A*", benchRoute(g, queries, alt));
+
+		alt.mode = ROUTE_BIDIRECTIONAL;
+		print("ALT bidirectional A*", benchRoute(g, queries, alt));
+
+		benchSuboptimal(g, queries);
+		benchCostPolicy(g, queries);
+		benchBatchScaling(g, queries);
+		benchDistanceTable(g);
+		benchPathCache(g);
+		benchIncremental(g, queries);
+		benchFlowField(g, queries);
+		benchSpatialIndex(g);
+		benchTimeSliced(g, queries);
+		benchPathService(g, queries);
+		benchCooperative(g);
+		benchAgents(g);
+		benchNavGraphFile(g, queries);
+		benchClone(g);
+		benchNodeOrder(g, queries);
+		benchUnreachable(g, queries);
+		benchHierarchical(g, queries);
+		benchContraction(g, queries);
+	}
+
+	//spatial index only, on scattered unlinked nodes
+	void runSpatialBenchmark(int num_nodes = 200000)
+	{
+		Graph g;
+		Rng rng(9);
+		float side = std::sqrt(float(num_nodes)) * 2;
+		for (int i = 0; i < num_nodes; i++)
+		{
+			g.addNode({ side * rng.nextFloat(), rng.nextFloat(), side * rng.nextFloat() });
+		}
+		benchSpatialIndex(g);
+	}
+
+	//agent updates only, 10k to 100k agents on the synthetic grid
+	void runAgentBenchmark(int w = 224, int h = 224)
+	{
+		Graph g;
+		makeGridGraph(g, w, h);
+		for (int num : { 10000, 30000, 100000 }) benchAgents(g, num);
+	}
+
+	//synthetic graph, headless sizing runs.
+	void runRouteBenchmark(int w = 224, int h = 224, int num_queries = 200)
+	{
+		Graph g;
+		TriangleBVH buildings;
+		makeGridGraph(g, w, h, .15f, 1, &buildings);
+		runRouteBenchmark(g, num_queries);
+		benchLineOfSight(g, makeQueries(g, num_queries), buildings);
+	}
+}
+#endif//ROUTE_BENCH_H